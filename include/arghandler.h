@@ -5,6 +5,7 @@
 #include "shared.h"
 
 int isPositiveNumber(const char *str, int *outValue);
+int parseLogLevel(const char *name);
 int psmgmtArgs(int argc, char *argv[]);
 // int workerArgs(int argc, char *argv[], WorkerConfig *config);
 void printUsage(const char *programName);
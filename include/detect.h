@@ -0,0 +1,27 @@
+#ifndef DETECT_H
+#define DETECT_H
+
+#include "globals.h"
+
+// Row kernels used by deadlock detection. Rows are allocationStride ints
+// long, a multiple of CACHE_LINE_INTS, with zero padding past maxResources.
+typedef struct {
+  const char *name;
+  void (*rowAccumulate)(int *work, const int *row, int count); // work += row
+} DetectionKernel;
+
+// Detection results that can be updated as processes are removed
+typedef struct {
+  bool *finish; // processSlots entries, true unless blocked for good
+  int *work;    // Instances free once every finished process has released
+  int unfinished;
+} Detection;
+
+const DetectionKernel *detectionKernel(void);
+const DetectionKernel *scalarDetectionKernel(void);
+int runDetection(bool *finish);
+int beginDetection(Detection *detection);
+int removeFromDetection(Detection *detection, int index);
+void endDetection(Detection *detection);
+
+#endif
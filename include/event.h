@@ -0,0 +1,33 @@
+#ifndef EVENT_H
+#define EVENT_H
+
+#include "globals.h"
+
+typedef enum {
+  EVENT_LAUNCH,         // Try to launch another worker
+  EVENT_TABLE_DUMP,     // Log resource and process tables
+  EVENT_DEADLOCK_CHECK, // Run deadlock detection
+  EVENT_WORKER_WAKE     // A parked worker's next action is due
+} EventType;
+
+typedef struct {
+  unsigned long time; // Simulated time in nanoseconds
+  EventType type;
+  int index; // Process table slot for EVENT_WORKER_WAKE
+  pid_t pid; // Owner of that slot when the event was scheduled
+} SimEvent;
+
+// Binary min-heap of pending events ordered by simulated time
+typedef struct {
+  SimEvent *events;
+  int size;
+  int capacity;
+} EventQueue;
+
+int initEventQueue(EventQueue *q, int capacity);
+void freeEventQueue(EventQueue *q);
+int pushEvent(EventQueue *q, SimEvent event);
+int popEvent(EventQueue *q, SimEvent *event);
+const SimEvent *peekEvent(const EventQueue *q);
+
+#endif
@@ -8,6 +8,7 @@
 #include <semaphore.h>
 #include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -19,24 +20,26 @@
 #include <sys/wait.h>
 #include <unistd.h>
 
-#define MSG_REQUEST_RESOURCE 1
-#define MSG_RELEASE_RESOURCE 0
+#define MSG_TYPE_MASTER 1 // mtype reserved for messages addressed to psmgmt
 
 #define REQUEST_INTERVAL_NANOSECONDS 500000000 // Half a second in nanoseconds
 
 #define HALF_SECOND 500000000L // 500 milliseconds in nanoseconds
 #define ONE_SECOND 1000000000L // One second in nanoseconds
 
-// absolute maximums
-#define MAX_PROCESSES 50
-#define MAX_SIMULTANEOUS 18
-#define MAX_RESOURCES 20
-#define MAX_INSTANCES 40
+// absolute maximums; the tables themselves are sized at runtime
+#define MAX_PROCESSES 10000
+#define MAX_SIMULTANEOUS 1000
+#define MAX_RESOURCES 512
+#define MAX_INSTANCES 10000
 #define MAX_RESOURCE_TYPES 10
+#define MAX_THREAD_PROCESSES 1000000 // -w thread: small stacks, no fork
+#define MAX_THREAD_SIMULTANEOUS 10000
 
 // default values assigned to variables
 #define DEFAULT_MAX_RESOURCES 10
 #define DEFAULT_MAX_PROCESSES 18
+#define DEFAULT_MAX_SIMULTANEOUS 18
 #define DEFAULT_MAX_INSTANCES 20
 
 #define DEFAULT_CHILD_TIME_LIMIT 10
@@ -52,9 +55,10 @@
 #define SHM_PATH "/tmp"
 #define SHM_PROJ_ID_SIM_CLOCK 'S'
 #define SHM_PROJ_ID_ACT_TIME 'A'
-#define SHM_PROJ_ID_PROCESS_TABLE 'P'
-#define SHM_PROJ_ID_RESOURCE_TABLE 'R'
+#define SHM_PROJ_ID_TABLES 'P'
 #define SHM_PROJ_ID_DEADLOCK 'D'
+#define SHM_PROJ_ID_RING 'Q'
+#define SHM_PROJ_ID_STATS 'M'
 
 #define SEM_PERMISSIONS 0666
 #define MSQ_PERMISSIONS 0666
@@ -67,6 +71,16 @@
 #define LOG_LEVEL_WARN 3
 #define LOG_LEVEL_ERROR 4
 
+// log_message() calls below LOG_LEVEL_FLOOR are compiled out. Debug builds
+// keep every level; otherwise set it with make LOG_FLOOR=n.
+#ifndef LOG_LEVEL_FLOOR
+#ifdef DEBUG
+#define LOG_LEVEL_FLOOR LOG_LEVEL_ANNOY
+#else
+#define LOG_LEVEL_FLOOR LOG_LEVEL_INFO
+#endif
+#endif
+
 // Error codes
 #define SUCCESS 0
 #define ERROR_INVALID_ARGS -64
@@ -80,10 +94,15 @@
 
 #define LOG_BUFFER_SIZE 1024
 
+#define CACHE_LINE_INTS 16 // ints per 64-byte cache line
+
 typedef struct {
-  unsigned long seconds;
-  unsigned long nanoseconds;
+  _Atomic unsigned int sequence; // Seqlock counter, odd while being written
+  _Atomic unsigned int waiters;  // Processes futex-waiting on sequence
+  _Atomic unsigned long seconds;
+  _Atomic unsigned long nanoseconds;
   int initialized;
+  int eventDriven; // Discrete-event mode: psmgmt jumps to the next event
 } SimulatedClock, ActualTime;
 
 typedef struct PCB {
@@ -91,23 +110,56 @@ typedef struct PCB {
   pid_t pid;
   int startSeconds;
   int startNano;
-  int blocked;
-  int eventBlockedUntilSec;
-  int eventBlockedUntilNano;
-  int state;
+  _Atomic int blocked; // WORKER_BUSY/PARKED/SCHEDULED in discrete-event mode
+  _Atomic int eventBlockedUntilSec;  // Next simulated time the worker acts
+  _Atomic int eventBlockedUntilNano;
+  _Atomic int state; // PROCESS_*; a pooled worker futex-waits on it
+  int victimsTaken; // Deadlock victims killed so this process could go on
 } PCB;
 
+// Start of the shared table segment. psmgmt lays out the process table,
+// resource vectors and allocation matrices behind it; workers size
+// themselves from these fields instead of the compile-time limits.
+typedef struct {
+  int processSlots;     // PCBs and allocation rows, recycled as processes exit
+  int resourceCount;    // Resource classes
+  int maxInstances;     // Instances of each resource class
+  int maxSimultaneous;  // Children allowed to run at once
+  int claimsRequired;   // -a: workers declare maximum claims before asking
+  int logLevel;         // -l: workers log at psmgmt's level
+  int allocationStride; // Ints per process row, padded to a cache line
+  size_t processTableOffset; // Byte offsets from the start of the segment
+  size_t totalOffset;
+  size_t availableOffset;
+  size_t allocationOffset;
+  size_t claimOffset;
+  size_t size;
+} TableHeader;
+
 typedef enum { LOG_DEBUG, LOG_INFO, LOG_WARN, LOG_ERROR } LogLevel;
 
 typedef enum { PROCESS_TYPE_PSMGMT, PROCESS_TYPE_WORKER } ProcessType;
 
+typedef enum { TRANSPORT_MSQ, TRANSPORT_RING } TransportType;
+
+typedef enum { RUNTIME_PROCESS, RUNTIME_THREAD } WorkerRuntime;
+
 extern int maxResources;
 extern int maxProcesses;
 extern int maxInstances;
+extern int maxSimultaneous;
+extern int processSlots;
 extern int launchInterval;
+extern bool discreteEvents;
+extern bool avoidDeadlocks;
+extern int poolSize;
+extern TransportType transportType;
+extern WorkerRuntime workerRuntime;
 extern char logFileName[256];
+extern char traceFileName[256];
 extern FILE *logFile;
 
+extern TableHeader *tableHeader;
 extern PCB *processTable;
 extern pthread_mutex_t processTableMutex;
 
@@ -122,7 +174,6 @@ extern int msqId;
 extern int simulatedTimeShmId;
 extern int actualTimeShmId;
 extern int processTableShmId;
-extern int resourceTableShmId;
 
 extern volatile sig_atomic_t keepRunning;
 extern volatile sig_atomic_t childTerminated;
@@ -130,6 +181,12 @@ extern volatile sig_atomic_t childTerminated;
 extern int childTimeLimit;
 extern int currentChildren;
 
+// Synchronization domains:
+//   clock     - seqlock inside simClock/actualTime, see simclock.h; clockSem
+//               is only held while the clock segments are attached/detached
+//   tables    - processTableMutex/resourceTableMutex, psmgmt-private
+//   transport - none; the kernel serializes the message queue and each ring
+//               has a single producer and a single consumer
 extern sem_t *clockSem;
 extern const char *clockSemName;
 
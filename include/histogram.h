@@ -0,0 +1,30 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <stdint.h>
+
+#include "globals.h"
+
+// Log-linear (HDR-style) histogram of nanosecond values. Values below
+// HISTOGRAM_SUB_BUCKETS get a bucket each; above that every power of two is
+// split into HISTOGRAM_SUB_BUCKETS equal buckets, so a bucket is never wider
+// than 1/16 of the values in it. Recording is one relaxed atomic add, so
+// several processes can share one in shared memory.
+#define HISTOGRAM_SUB_BITS 4
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_MAX_BITS 40 // Up to ~18 minutes; longer values clamp
+#define HISTOGRAM_BUCKETS                                                      \
+  ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+typedef struct {
+  _Atomic uint64_t count;
+  _Atomic uint64_t max; // Exact, not rounded to a bucket
+  _Atomic uint32_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+int histogramBucket(uint64_t value);
+uint64_t histogramBucketHighest(int bucket);
+void histogramRecord(Histogram *histogram, uint64_t value);
+uint64_t histogramPercentile(const Histogram *histogram, double percentile);
+
+#endif
@@ -13,6 +13,7 @@ int initializeSemaphore(void);
 int initializeClockAndTime(void);
 int initializeResourceTable(void);
 int initializeProcessTable(void);
+int attachTables(void);
 void initializeSharedResources(void);
 
 #endif
@@ -0,0 +1,19 @@
+#ifndef LOGRING_H
+#define LOGRING_H
+
+#include "globals.h"
+
+// Asynchronous log pipeline for psmgmt. log_message() formats into a slot of
+// a bounded lock-free MPSC ring and a flusher thread writes the records out
+// in large batches. Processes that never start the flusher (workers, tests)
+// keep writing each line synchronously.
+#define LOG_RING_SLOTS 1024          // Records in flight, a power of two
+#define LOG_FLUSH_BUFFER (64 * 1024) // Bytes gathered per write
+#define LOG_FLUSH_IDLE_NS 10000000L  // Flusher's sleep when the ring is empty
+#define LOG_STALL_YIELDS 1000        // Yields before a warning is dropped
+
+int startLogFlusher(void);
+void stopLogFlusher(void);
+bool logRingPush(int level, int logToFile, const char *text, int length);
+
+#endif
@@ -15,11 +15,25 @@
 #define PROCESS_RUNNING 1
 #define PROCESS_WAITING 2
 #define PROCESS_TERMINATED 3
+#define PROCESS_POOLED 4 // Spawned ahead of time, parked until launched
+
+#define POOLED_WORKER_ARG "--pooled" // argv[1] of a worker spawned for the pool
+// Pooled workers recheck psmgmt this often
+#define POOL_WAIT_TIMEOUT_NS 100000000L
+
+// PCB.blocked in discrete-event mode
+#define WORKER_BUSY 0      // Acting; psmgmt must not advance the clock
+#define WORKER_PARKED 1    // Worker published its next wake time
+#define WORKER_SCHEDULED 2 // psmgmt queued the wake-up event
+#define WORKER_WAITING 3   // Worker is blocked until its queued request is met
 
 void registerChildProcess(pid_t pid);
+int registerPooledProcess(pid_t pid);
+void activatePooledProcess(int index);
+int waitForActivation(PCB *slot);
 int findFreeProcessTableEntry(void);
 int stillChildrenToLaunch(void);
-pid_t forkAndExecute(const char *executable);
+pid_t spawnWorker(const char *executable, bool pooled);
 void handleTermination(pid_t pid);
 void freeAllProcessResources(int index);
 void updateResourceAndProcessTables(void);
@@ -29,5 +43,10 @@ const char *processStateToString(int state);
 void clearProcessEntry(int index);
 int killProcess(int pid, int sig);
 int findProcessIndexByPID(int pid);
+int rebuildProcessIndex(void);
+void freeProcessIndex(void);
+PCB *attachWorkerSlot(pid_t pid);
+void parkWorker(PCB *slot, unsigned long wakeAt);
+bool allWorkersParked(void);
 
 #endif
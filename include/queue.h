@@ -18,5 +18,8 @@ int initQueue(Queue *q, int capacity);
 void freeQueue(Queue *q);
 void enqueue(Queue *q, MessageA5 item);
 int dequeue(Queue *q, MessageA5 *item);
+int queueLength(const Queue *q);
+const MessageA5 *queueAt(const Queue *q, int position);
+int removeFromQueue(Queue *q, int position);
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+
+#include "globals.h"
+#include "shared.h"
+
+#define REACTOR_TICK_NS 25000000L // Wall time between clock ticks (25ms)
+#define REACTOR_MAX_EVENTS 8
+#define WAKEUP_FD_ENV "PSMGMT_WAKEUP_FD" // eventfd inherited by workers
+
+// Readiness bits returned by waitForEvents()
+#define REACTOR_TICK 0x1   // timerfd expired, advance the clock
+#define REACTOR_CHILD 0x2  // SIGCHLD arrived through the signalfd
+#define REACTOR_WAKEUP 0x4 // A worker posted a message and kicked the eventfd
+
+int initializeReactor(bool clockTick);
+unsigned int waitForEvents(int timeoutMs, unsigned long *ticks);
+void closeReactor(void);
+void notifyMaster(void);
+
+#endif
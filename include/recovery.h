@@ -0,0 +1,25 @@
+#ifndef RECOVERY_H
+#define RECOVERY_H
+
+#include "globals.h"
+
+// What the cost function knows about a process that could be killed to
+// break a deadlock
+typedef struct {
+  int index;             // Process table slot
+  int resourcesHeld;     // Instances held across every class
+  unsigned long age;     // Simulated nanoseconds since launch
+  unsigned long waited;  // Simulated nanoseconds blocked on its request
+  int priorKills;        // Victims already killed so it could go on
+} VictimCandidate;
+
+// Lower cost means less work thrown away; the cheapest candidate dies first
+typedef double (*VictimCostFunction)(const VictimCandidate *candidate);
+
+extern VictimCostFunction victimCost;
+
+double defaultVictimCost(const VictimCandidate *candidate);
+int chooseVictim(const int *candidates, int count);
+void recordVictim(int victim, const int *candidates, int count);
+
+#endif
@@ -5,21 +5,38 @@
 #include "process.h"
 #include "shared.h"
 
-typedef struct {
-  int total;                       // Total number of instances
-  int available;                   // Number of available instances
-  int allocated[MAX_SIMULTANEOUS]; // Number of allocated instances for each
-                                   // process
-} ResourceDescriptor;
+// Instances of resourceType held by the process in table slot index. Each
+// process owns a cache-aligned row, so walking one process's allocations is
+// a contiguous scan. Read-only: write through setAllocation().
+#define ALLOCATED(index, resourceType)                                         \
+  allocationMatrix[(size_t)(index) * allocationStride + (resourceType)]
+
+// Maximum instances of resourceType the process in slot index declared it
+// may hold at once. Only used with -a; same layout as ALLOCATED().
+#define CLAIMED(index, resourceType)                                           \
+  claimMatrix[(size_t)(index) * allocationStride + (resourceType)]
+
+// requestResource() results
+#define REQUEST_GRANTED 0
+#define REQUEST_WAIT -1   // Cannot be met yet; the request should be queued
+#define REQUEST_DENIED -2 // Never valid as sent; answer it right away
 
 typedef enum {
-  REQUEST_RESOURCE, // Request for a resource allocation
-  RELEASE_RESOURCE, // Release of a resource
-  TERMINATE_PROCESS // Signal to terminate a process
+  REQUEST_RESOURCE,  // Request for a resource allocation
+  RELEASE_RESOURCE,  // Release of a resource
+  TERMINATE_PROCESS, // Signal to terminate a process
+  REGISTER_CLAIM,    // Declare the maximum claims, as a vector, with -a
+  REQUEST_VECTOR,    // Several classes at once, granted all-or-nothing
+  RELEASE_VECTOR,    // Give back several classes at once
+  RELEASE_ALL        // Give back everything held
 } ActionType;
 
 extern pthread_mutex_t resourceTableMutex;
-extern ResourceDescriptor *resourceTable;
+extern int *resourceTotal;     // Instances of each resource class
+extern int *resourceAvailable; // Instances not currently allocated
+extern int *allocationMatrix;  // Process-major, see ALLOCATED()
+extern int *claimMatrix;       // Process-major, see CLAIMED()
+extern int allocationStride;
 
 extern int totalRequests;
 extern int immediateGrantedRequests;
@@ -27,16 +44,36 @@ extern int waitingGrantedRequests;
 extern int terminatedByDeadlock;
 extern int successfullyTerminated;
 extern int deadlockDetectionRuns;
+extern int unsafeDeniedRequests;
 extern int processesTerminatedByDeadlockDetection;
 
+extern void (*onDeadlockVictim)(int index);
+
 bool isProcessRunning(int pid);
+void setAllocation(int index, int resourceType, int count);
 void log_resource_state(const char *operation, int pid, int resourceType,
                         int count, int availableBefore, int availableAfter);
 int requestResource(int pid, int resourceType, int count);
+int grantQueuedRequest(int pid, int resourceType, int count);
+int grantQueuedVector(const MessageA5 *msg);
+int vectorWaitingOn(const MessageA5 *msg);
+int vectorCount(const MessageA5 *msg, int resourceType);
 int releaseResource(int pid, int resourceType, int count);
+void applyResourceBatch(const MessageA5 *const *messages, int count,
+                        int *results);
+void noteFreedResource(int resourceType);
+int takeFreedResource(void);
+int registerClaim(const MessageA5 *msg);
 void releaseAllResourcesForProcess(int pid);
+
+#define RESOURCE_TABLE_FULL_DUMPS 20 // Periodic dumps between full tables
 void logResourceTable(void);
+int logResourceTableChanges(void);
+void freeResourceTableLog(void);
+
+void freeSafetyState(void);
 bool unsafeSystem(void);
+void terminateDeadlockedProcess(int index);
 void resolveDeadlocks(void);
 void logStatistics(void);
 
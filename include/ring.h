@@ -0,0 +1,44 @@
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+
+#include "globals.h"
+#include "shared.h"
+
+#define RING_CAPACITY 64 // Messages per ring, must be a power of two
+#define CACHE_LINE_SIZE 64
+
+#define RING_ATTACH_RETRIES 1000 // Worker waits up to ~1s for its ring
+
+// Single-producer/single-consumer ring owned by one process table slot. The
+// worker in that slot is the only producer, psmgmt is the only consumer.
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) _Atomic unsigned int tail; // Written by worker
+  _Alignas(CACHE_LINE_SIZE) _Atomic unsigned int head; // Written by psmgmt
+  _Alignas(CACHE_LINE_SIZE) _Atomic pid_t owner; // Worker bound to this ring
+  MessageA5 messages[RING_CAPACITY];
+} MessageRing;
+
+typedef struct {
+  int enabled;   // Set by psmgmt when the ring transport is selected
+  int ringCount; // Number of rings, one per process table slot
+  _Alignas(CACHE_LINE_SIZE) _Atomic int masterSleeping; // psmgmt in epoll
+  MessageRing rings[]; // ringCount entries, sized when psmgmt starts
+} RingTransport;
+
+extern RingTransport *ringTransport;
+extern MessageRing *workerRing;
+extern int ringTransportShmId;
+
+int initializeRingTransport(void);
+int attachWorkerRing(pid_t pid);
+void assignRing(int index, pid_t pid);
+int ringPush(MessageRing *ring, const MessageA5 *msg);
+int ringPop(MessageRing *ring, MessageA5 *msg);
+int drainRings(MessageA5 *batch, int maxMessages);
+bool ringsPending(void);
+int sendToMaster(const MessageA5 *msg);
+const char *transportTypeToString(TransportType type);
+
+#endif
@@ -22,13 +22,39 @@
 #include "globals.h"
 #include "user_process.h"
 
+// Outcome psmgmt reports in a reply. Requests leave status at REPLY_NONE.
+typedef enum {
+  REPLY_NONE,
+  REPLY_GRANTED, // Done; count is the number of instances moved
+  REPLY_QUEUED,  // Request is waiting, a GRANTED or KILLED reply follows
+  REPLY_DENIED,  // Cannot be honoured as sent
+  REPLY_KILLED   // Chosen as a deadlock victim; everything held is gone
+} ReplyStatus;
+
+#define VECTOR_MAX_ENTRIES 8 // Resource classes one vector message can carry
+
+typedef struct {
+  int resourceType;
+  int count;
+} ResourceCount;
+
 typedef struct {
   long senderPid;   // Process ID
   int commandType;  // Type of command (request or release)
   int resourceType; // Type of resource
   int count;        // Number of resources
+  int status;       // ReplyStatus, set on replies only
+  int vectorLength; // Entries used in vector, for vector commands only
+  ResourceCount vector[VECTOR_MAX_ENTRIES];
 } MessageA5;
 
+// System V envelope. Worker->psmgmt traffic uses MSG_TYPE_MASTER, replies
+// from psmgmt are addressed to the worker by using its PID as the mtype.
+typedef struct {
+  long mtype;
+  MessageA5 body;
+} MessageEnvelope;
+
 int getCurrentChildren(void);
 void setCurrentChildren(int value);
 
@@ -36,10 +62,21 @@ void cleanupSharedResources(void);
 
 void *attachSharedMemory(const char *path, int proj_id, size_t size,
                          const char *segmentName);
+void *createSharedMemory(const char *path, int proj_id, size_t size,
+                         const char *segmentName, int *shmIdOut);
 int detachSharedMemory(void **shmPtr, const char *segmentName);
-void log_message(int level, int logToFile, const char *format, ...);
+void writeLogMessage(int level, int logToFile, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
 key_t getSharedMemoryKey(const char *path, int proj_id);
-int sendMessage(int msqId, const void *msg, size_t msgSize);
-int receiveMessage(int msqId, void *msg, size_t msgSize, int flags);
+int sendMessage(int msqId, long mtype, const MessageA5 *msg);
+int receiveMessage(int msqId, long mtype, MessageA5 *msg, int flags);
+
+// Levels below the build floor leave no code behind, and the arguments of a
+// call below the runtime level are never evaluated
+#define log_message(level, logToFile, ...)                                     \
+  do {                                                                         \
+    if ((level) >= LOG_LEVEL_FLOOR && (level) >= currentLogLevel)              \
+      writeLogMessage((level), (logToFile), __VA_ARGS__);                      \
+  } while (0)
 
 #endif
@@ -12,7 +12,6 @@
 
 void parentSignalHandler(int sig);
 void setupParentSignalHandlers(void);
-void childExitHandler(int sig);
 void atexitHandler(void);
 void setupTimeout(int seconds);
 void timeoutHandler(int signum);
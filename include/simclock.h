@@ -0,0 +1,21 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#include "globals.h"
+
+#define CLOCK_WAIT_TIMEOUT_NS 10000000L // Recheck the clock every 10ms or so
+
+// The clock segments are single-writer seqlocks: psmgmt is the only writer,
+// every other process samples them without taking a lock.
+void readClock(const SimulatedClock *clock, unsigned long *seconds,
+               unsigned long *nanoseconds);
+void writeClock(SimulatedClock *clock, unsigned long seconds,
+                unsigned long nanoseconds);
+void advanceClock(SimulatedClock *clock, unsigned long nanoseconds);
+unsigned long clockNanoseconds(const SimulatedClock *clock);
+void waitForClock(SimulatedClock *clock, unsigned long target);
+
+#endif
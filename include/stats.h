@@ -0,0 +1,93 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+#include "globals.h"
+#include "histogram.h"
+#include "ring.h"
+
+// Live statistics segment. psmgmt publishes its counters, queue depths and
+// resource use here a few times per wall-clock second, and each worker
+// counts its own traffic in its process table slot, so psmgmt-stat can watch
+// a run from outside. Every field is atomic: a value is never torn, though
+// one sample may straddle two snapshots. Workers also record how long each
+// of their requests took to be granted.
+#define STATS_MAGIC "PSMSTATS"
+#define STATS_VERSION 2
+#define STATS_PUBLISH_INTERVAL_NS 10000000L // At most one snapshot per 10ms
+
+typedef struct {
+  _Atomic int32_t inUse;      // Instances allocated
+  _Atomic int32_t queueDepth; // Requests waiting on this class
+} ResourceStats;
+
+// Grant latency is split by whether the request had to queue first, and
+// measured on both clocks
+typedef enum { LATENCY_IMMEDIATE, LATENCY_QUEUED, LATENCY_KINDS } LatencyKind;
+typedef enum { LATENCY_SIMULATED, LATENCY_WALL, LATENCY_CLOCKS } LatencyClock;
+
+// Written by the worker in the slot, so each gets its own cache line
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) _Atomic int32_t pid;
+  _Atomic int32_t active; // Set while the worker is running
+  _Atomic uint64_t requests;
+  _Atomic uint64_t grants;
+  _Atomic uint64_t waits; // Requests that were queued first
+  _Atomic uint64_t denials;
+  _Atomic uint64_t releases;
+} WorkerStats;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerSize;
+  int32_t resourceCount;
+  int32_t processSlots;
+  int32_t maxInstances;
+  pid_t psmgmtPid;
+  size_t resourceOffset; // Byte offsets from the start of the segment
+  size_t workerOffset;
+  size_t latencyOffset;
+  size_t size;
+  _Atomic int32_t running;         // Cleared once psmgmt is done
+  _Atomic uint64_t published;      // Snapshots written so far
+  _Atomic uint64_t simulatedTime;  // Nanoseconds
+  _Atomic int32_t currentChildren;
+  _Atomic uint64_t launched;
+  _Atomic uint64_t exited;
+  _Atomic uint64_t requests;
+  _Atomic uint64_t immediateGrants;
+  _Atomic uint64_t queuedGrants;
+  _Atomic uint64_t unsafeDenials; // -a only
+  _Atomic uint64_t deadlockChecks;
+  _Atomic uint64_t deadlockKills;
+} StatsHeader;
+
+#define STATS_RESOURCES(header)                                                \
+  ((ResourceStats *)((char *)(header) + (header)->resourceOffset))
+#define STATS_WORKERS(header)                                                  \
+  ((WorkerStats *)((char *)(header) + (header)->workerOffset))
+
+// Bumps a WorkerStats counter; stats is NULL when nothing is published
+#define statsCount(stats, field)                                               \
+  do {                                                                         \
+    if ((stats) != NULL)                                                       \
+      atomic_fetch_add_explicit(&(stats)->field, 1, memory_order_relaxed);     \
+  } while (0)
+
+extern StatsHeader *statsHeader;
+extern int statsShmId;
+
+int openStats(void);
+void publishStats(bool force);
+void closeStats(void);
+int attachStats(bool readOnly);
+WorkerStats *workerStats(pid_t pid);
+Histogram *grantLatency(int resourceType, LatencyKind kind,
+                        LatencyClock clock);
+void recordGrantLatency(int resourceType, LatencyKind kind,
+                        uint64_t simulatedNs, uint64_t wallNs);
+void logGrantLatencies(void);
+
+#endif
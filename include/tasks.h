@@ -0,0 +1,25 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include "globals.h"
+#include "shared.h"
+
+// -w thread: workers run as threads inside psmgmt. Their messages go through
+// an in-memory channel that psmgmt drains in place of the message queue, and
+// each task has a small mailbox for its replies. Task IDs stand in for PIDs
+// in the process table.
+#define TASK_ID_BASE 0x40000000 // Above pid_max, so no ID names a process
+#define TASK_MAILBOX_SIZE 8     // Replies a task can have outstanding
+#define TASK_STACK_SIZE (256 * 1024)
+#define TASK_CHANNEL_INITIAL 256 // Channel slots, doubled as needed
+
+int initWorkerTasks(void);
+pid_t nextTaskId(void);
+int startWorkerTask(pid_t id);
+int drainTaskChannel(MessageA5 *batch, int maxMessages);
+int deliverToTask(pid_t id, const MessageA5 *reply);
+void killWorkerTask(pid_t id);
+pid_t reapWorkerTask(void);
+void stopWorkerTasks(void);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+#include "globals.h"
+
+// Binary event trace (-e). psmgmt appends fixed-size records to a file it
+// maps into memory, so recording an event is a few stores; psmgmt-trace
+// renders the file afterwards, or while the run is still going.
+#define TRACE_MAGIC "PSMTRACE"
+#define TRACE_VERSION 1
+#define TRACE_GROW_RECORDS 65536 // File grows by this many records at a time
+
+typedef enum {
+  TRACE_LAUNCH,         // Worker started in slot index
+  TRACE_REQUEST,        // First attempt at a request
+  TRACE_GRANT,          // Granted on its first attempt
+  TRACE_GRANT_QUEUED,   // Granted to a waiter by the grant scheduler
+  TRACE_WAIT,           // Queued until instances free up
+  TRACE_DENY,           // Refused
+  TRACE_RELEASE,        // Instances given back
+  TRACE_DEADLOCK_CHECK, // Periodic detection ran; count is processes killed
+  TRACE_KILL,           // Terminated as a deadlock victim
+  TRACE_EXIT,           // Worker exited and its slot was freed
+  TRACE_EVENT_TYPES
+} TraceEventType;
+
+typedef enum {
+  TRACE_FORMAT_TEXT,
+  TRACE_FORMAT_CSV,
+  TRACE_FORMAT_SPEC
+} TraceFormat;
+
+typedef struct {
+  uint64_t time;        // Simulated nanoseconds
+  int32_t pid;
+  int32_t index;        // Process table slot, or -1
+  int32_t resourceType; // Or -1
+  int32_t count;        // Instances moved
+  int32_t available;    // Instances of resourceType free afterwards
+  uint16_t type;        // TraceEventType
+  uint16_t reserved;
+} TraceRecord;
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  uint32_t recordSize;
+  _Atomic uint64_t count; // Records written, published after each one
+  uint64_t capacity;      // Records the file has room for
+} TraceHeader;
+
+// A trace file mapped for reading
+typedef struct {
+  const TraceHeader *header;
+  const TraceRecord *records;
+  uint64_t count;
+  size_t length;
+} TraceView;
+
+extern TraceHeader *traceHeader;
+
+int openTrace(const char *path);
+void closeTrace(void);
+void recordTraceEvent(int type, pid_t pid, int index, int resourceType,
+                      int count);
+int loadTrace(const char *path, TraceView *view);
+void unloadTrace(TraceView *view);
+const char *traceEventName(int type);
+int formatTraceRecord(const TraceRecord *record, TraceFormat format,
+                      char *buffer, size_t size);
+
+// Costs one branch when no trace was asked for
+#define traceEvent(type, pid, index, resourceType, count)                      \
+  do {                                                                         \
+    if (traceHeader != NULL)                                                   \
+      recordTraceEvent((type), (pid), (index), (resourceType), (count));       \
+  } while (0)
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef WAITGRAPH_H
+#define WAITGRAPH_H
+
+#include "globals.h"
+
+// Wait-for graph kept by psmgmt. A blocked process waits on one resource
+// class, and through it on every process holding that class, so edges are
+// stored as waitingOn (process -> resource) plus a holder bitset per resource
+// (resource -> process). Both halves change in O(1) as requests block and
+// allocations come and go.
+int initWaitGraph(void);
+void freeWaitGraph(void);
+void waitGraphBlock(int index, int resourceType, int count);
+void waitGraphUnblock(int index);
+int waitGraphWaitingOn(int index);
+bool waitGraphRequestFits(int index, const int *work);
+unsigned long waitGraphWaitTime(int index, unsigned long now);
+void waitGraphHoldingChanged(int index, int resourceType, bool holds);
+int findDeadlockFrom(int index, const int **deadlocked);
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef WORKER_H
+#define WORKER_H
+
+#include <stdatomic.h>
+
+#include "globals.h"
+#include "shared.h"
+#include "stats.h"
+
+// One simulated user process. The same loop runs as a workerA5 process or,
+// with -w thread, as a task thread inside psmgmt; only the way its messages
+// travel differs.
+typedef struct WorkerContext {
+  pid_t id;           // Process ID, or the task ID psmgmt handed out
+  int *heldResources; // Instances held, one entry per resource class
+  int *maxClaim;      // Most of each class this worker will ever hold
+  unsigned int seed;  // rand_r() state, so tasks do not share one
+  _Atomic bool running;
+  WorkerStats *stats; // This worker's published counters, or NULL
+  unsigned long requestSentAt;     // Simulated ns the last request went out
+  unsigned long requestSentAtWall; // The same on the monotonic clock
+  int (*send)(struct WorkerContext *worker, const MessageA5 *msg);
+  // Blocks for the next reply; 0, or -1 once psmgmt is gone
+  int (*receive)(struct WorkerContext *worker, MessageA5 *reply);
+} WorkerContext;
+
+int initWorkerContext(WorkerContext *worker, pid_t id);
+void freeWorkerContext(WorkerContext *worker);
+void runWorker(WorkerContext *worker);
+
+#endif
@@ -12,24 +12,44 @@ int isPositiveNumber(const char *str, int *outValue) {
   return 1;
 }
 
+// Maps a -l argument to its LOG_LEVEL_*, or -1
+int parseLogLevel(const char *name) {
+  static const char *const names[] = {"annoy", "debug", "info", "warn",
+                                      "error"};
+  for (int level = LOG_LEVEL_ANNOY; level <= LOG_LEVEL_ERROR; level++) {
+    if (strcmp(name, names[level]) == 0)
+      return level;
+  }
+  return -1;
+}
+
 int psmgmtArgs(int argc, char *argv[]) {
   optind = 1; // Reset getopt's 'optind'
   int opt;
   int tempValue;
 
-  while ((opt = getopt(argc, argv, "hn:i:f:r:u:")) != -1) {
+  while ((opt = getopt(argc, argv, "hn:s:i:f:r:u:q:dap:w:l:e:")) != -1) {
     switch (opt) {
     case 'h':
       printUsage(argv[0]);
       return 1;
-    case 'n':
-      if (!isPositiveNumber(optarg, &tempValue) || tempValue > MAX_PROCESSES) {
-        fprintf(stderr, "Invalid or too many processes specified: %s\n",
+    case 'n': // Limits depend on -w, checked below
+      if (!isPositiveNumber(optarg, &tempValue)) {
+        fprintf(stderr, "Invalid number of processes specified: %s\n",
                 optarg);
         return ERROR_INVALID_ARGS;
       }
       maxProcesses = tempValue;
       break;
+    case 's':
+      if (!isPositiveNumber(optarg, &tempValue)) {
+        fprintf(stderr,
+                "Invalid number of simultaneous processes specified: %s\n",
+                optarg);
+        return ERROR_INVALID_ARGS;
+      }
+      maxSimultaneous = tempValue;
+      break;
     case 'i':
       if (!isPositiveNumber(optarg, &tempValue)) {
         fprintf(stderr, "Invalid launch interval specified: %s\n", optarg);
@@ -63,26 +83,88 @@ int psmgmtArgs(int argc, char *argv[]) {
       }
       maxInstances = tempValue;
       break;
+    case 'q':
+      if (strcmp(optarg, "msq") == 0) {
+        transportType = TRANSPORT_MSQ;
+      } else if (strcmp(optarg, "ring") == 0) {
+        transportType = TRANSPORT_RING;
+      } else {
+        fprintf(stderr, "Invalid transport specified: %s\n", optarg);
+        return ERROR_INVALID_ARGS;
+      }
+      break;
+    case 'd':
+      discreteEvents = true;
+      break;
+    case 'a':
+      avoidDeadlocks = true;
+      break;
+    case 'p':
+      if (!isPositiveNumber(optarg, &tempValue) ||
+          tempValue > MAX_SIMULTANEOUS) {
+        fprintf(stderr, "Invalid or too large worker pool specified: %s\n",
+                optarg);
+        return ERROR_INVALID_ARGS;
+      }
+      poolSize = tempValue;
+      break;
+    case 'w':
+      if (strcmp(optarg, "process") == 0) {
+        workerRuntime = RUNTIME_PROCESS;
+      } else if (strcmp(optarg, "thread") == 0) {
+        workerRuntime = RUNTIME_THREAD;
+      } else {
+        fprintf(stderr, "Invalid worker runtime specified: %s\n", optarg);
+        return ERROR_INVALID_ARGS;
+      }
+      break;
+    case 'l':
+      if ((tempValue = parseLogLevel(optarg)) == -1) {
+        fprintf(stderr, "Invalid log level specified: %s\n", optarg);
+        return ERROR_INVALID_ARGS;
+      }
+      currentLogLevel = tempValue;
+      break;
+    case 'e':
+      strncpy(traceFileName, optarg, sizeof(traceFileName) - 1);
+      traceFileName[sizeof(traceFileName) - 1] = '\0';
+      break;
     default:
       printUsage(argv[0]);
       return ERROR_INVALID_ARGS;
     }
   }
+
+  bool threads = workerRuntime == RUNTIME_THREAD;
+  int processLimit = threads ? MAX_THREAD_PROCESSES : MAX_PROCESSES;
+  int simultaneousLimit = threads ? MAX_THREAD_SIMULTANEOUS : MAX_SIMULTANEOUS;
+  if (maxProcesses > processLimit) {
+    fprintf(stderr, "Too many processes specified: %d (max: %d)\n",
+            maxProcesses, processLimit);
+    return ERROR_INVALID_ARGS;
+  }
+  if (maxSimultaneous > simultaneousLimit) {
+    fprintf(stderr, "Too many simultaneous processes specified: %d (max: %d)\n",
+            maxSimultaneous, simultaneousLimit);
+    return ERROR_INVALID_ARGS;
+  }
   return 0;
 }
 
 void printUsage(const char *programName) {
   printf("Usage: %s [-h] [-n num_procs] [-s simul_procs] [-i interval_ms] [-f "
-         "log_filename] [-r num_resources] [-u instances_per_resource]\n",
+         "log_filename] [-r num_resources] [-u instances_per_resource] [-q "
+         "transport] [-d] [-a] [-p pool_size] [-w runtime] [-l level] [-e "
+         "trace_file]\n",
          programName);
   printf("Options:\n");
   printf("  -h                Show this help message.\n");
   printf("  -n num_procs      Set the number of total child processes to spawn "
-         "(max: %d).\n",
-         MAX_PROCESSES);
+         "(max: %d, or %d with -w thread).\n",
+         MAX_PROCESSES, MAX_THREAD_PROCESSES);
   printf("  -s simul_procs    Set the number of child processes to spawn "
-         "simultaneously (max: %d).\n",
-         MAX_SIMULTANEOUS);
+         "simultaneously (max: %d, or %d with -w thread).\n",
+         MAX_SIMULTANEOUS, MAX_THREAD_SIMULTANEOUS);
   printf("  -i interval_ms    Set the interval in milliseconds to launch "
          "children.\n");
   printf("  -f log_filename   Set the filename for OSS output logs.\n");
@@ -92,6 +174,22 @@ void printUsage(const char *programName) {
   printf("  -u instances_per_resource Set the maximum number of instances per "
          "resource (max: %d).\n",
          MAX_INSTANCES);
+  printf("  -q transport      Set the worker message transport: msq (System V "
+         "message queue, default) or ring (shared-memory rings).\n");
+  printf("  -d                Run as a discrete-event simulation, jumping the "
+         "clock to the next scheduled event.\n");
+  printf("  -a                Avoid deadlocks: workers declare maximum claims "
+         "and each grant must pass the Banker's safety check.\n");
+  printf("  -p pool_size      Keep this many workers spawned and parked, so "
+         "launching one only has to wake it (max: %d).\n",
+         MAX_SIMULTANEOUS);
+  printf("  -w runtime        Run workers as process (one per worker, default) "
+         "or thread (inside psmgmt; -q and -p are ignored).\n");
+  printf("  -l level          Log at this level and above: annoy, debug, info "
+         "(default), warn or error. Levels below the build's LOG_FLOOR are "
+         "never logged.\n");
+  printf("  -e trace_file     Record every request, grant, release and kill "
+         "in a binary trace; read it with psmgmt-trace.\n");
 }
 
 /*
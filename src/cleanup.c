@@ -1,4 +1,12 @@
 #include "cleanup.h"
+#include "logring.h"
+#include "process.h"
+#include "queue.h"
+#include "reactor.h"
+#include "ring.h"
+#include "stats.h"
+#include "trace.h"
+#include "waitgraph.h"
 
 #include <signal.h>
 #include <stdio.h>
@@ -46,7 +54,20 @@ void cleanupResources(void) {
     clockSem = SEM_FAILED;
   }
 
-  // Close log file
+  closeStats(); // Final snapshot, while the tables are still there
+  closeReactor();
+  freeProcessIndex();
+  freeWaitGraph();
+  freeResourceTableLog();
+  freeSafetyState();
+  for (int i = 0; i < MAX_RESOURCES; i++) {
+    freeQueue(&resourceQueues[i]);
+  }
+
+  closeTrace();
+
+  // Close log file once the flusher has written out what it holds
+  stopLogFlusher();
   if (logFile) {
     fclose(logFile);
     logFile = NULL;
@@ -56,7 +77,7 @@ void cleanupResources(void) {
   cleanupSharedMemorySegment(simulatedTimeShmId, "Simulated Clock");
   cleanupSharedMemorySegment(actualTimeShmId, "Actual Time");
   cleanupSharedMemorySegment(processTableShmId, "Process Table");
-  cleanupSharedMemorySegment(resourceTableShmId, "Resource Table");
+  cleanupSharedMemorySegment(ringTransportShmId, "Message Rings");
 
   log_message(LOG_LEVEL_DEBUG, 0, "Cleanup completed.");
 }
@@ -0,0 +1,143 @@
+#include "detect.h"
+#include "resource.h"
+#include "waitgraph.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HAVE_X86_KERNELS 1
+#endif
+
+static void scalarRowAccumulate(int *work, const int *row, int count) {
+  for (int j = 0; j < count; j++) {
+    work[j] += row[j];
+  }
+}
+
+static const DetectionKernel scalarKernel = {"scalar", scalarRowAccumulate};
+
+#ifdef HAVE_X86_KERNELS
+__attribute__((target("sse4.1"))) static void
+sse41RowAccumulate(int *work, const int *row, int count) {
+  for (int j = 0; j < count; j += 4) {
+    __m128i w = _mm_loadu_si128((const __m128i *)&work[j]);
+    __m128i r = _mm_loadu_si128((const __m128i *)&row[j]);
+    _mm_storeu_si128((__m128i *)&work[j], _mm_add_epi32(w, r));
+  }
+}
+
+__attribute__((target("avx2"))) static void
+avx2RowAccumulate(int *work, const int *row, int count) {
+  for (int j = 0; j < count; j += 8) {
+    __m256i w = _mm256_loadu_si256((const __m256i *)&work[j]);
+    __m256i r = _mm256_loadu_si256((const __m256i *)&row[j]);
+    _mm256_storeu_si256((__m256i *)&work[j], _mm256_add_epi32(w, r));
+  }
+}
+
+static const DetectionKernel sse41Kernel = {"sse4.1", sse41RowAccumulate};
+static const DetectionKernel avx2Kernel = {"avx2", avx2RowAccumulate};
+#endif
+
+const DetectionKernel *scalarDetectionKernel(void) { return &scalarKernel; }
+
+// Picks the widest kernel this CPU supports, once
+const DetectionKernel *detectionKernel(void) {
+  static const DetectionKernel *selected = NULL;
+  if (selected != NULL)
+    return selected;
+
+  selected = &scalarKernel;
+#ifdef HAVE_X86_KERNELS
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    selected = &avx2Kernel;
+  } else if (__builtin_cpu_supports("sse4.1")) {
+    selected = &sse41Kernel;
+  }
+#endif
+  log_message(LOG_LEVEL_DEBUG, 0, "Deadlock detection kernel: %s",
+              selected->name);
+  return selected;
+}
+
+// Marks every process that can complete with the resources in work, adding
+// each one's allocations back as it finishes. A process can complete unless
+// it is blocked on a request work cannot meet; what it may ask for later is
+// not known, so it is not held against it. Returns the new unfinished count.
+static int detectionPass(bool *finish, int *work, int unfinished) {
+  const DetectionKernel *kernel = detectionKernel();
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (int i = 0; i < processSlots; i++) {
+      if (finish[i])
+        continue;
+      if (waitGraphRequestFits(i, work)) {
+        kernel->rowAccumulate(work, &ALLOCATED(i, 0), allocationStride);
+        finish[i] = true;
+        unfinished--;
+        progress = true;
+      }
+    }
+  }
+  return unfinished;
+}
+
+// Runs the detection loop over the allocation matrix. finish must hold
+// processSlots entries; on return it marks every process that can complete.
+// Returns the number of processes that cannot, or -1 on failure.
+int runDetection(bool *finish) {
+  int *work = aligned_alloc(64, allocationStride * sizeof(int));
+  if (work == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate detection state.");
+    return -1;
+  }
+
+  // The padding lanes of resourceAvailable are zero, like those of each row
+  memcpy(work, resourceAvailable, allocationStride * sizeof(int));
+  memset(finish, 0, processSlots * sizeof(bool));
+  int unfinished = detectionPass(finish, work, processSlots);
+
+  free(work);
+  return unfinished;
+}
+
+// Like runDetection(), but keeps its state so the result can be updated
+// cheaply as victims are removed. Returns the unfinished count, or -1.
+int beginDetection(Detection *detection) {
+  detection->finish = malloc(processSlots * sizeof(bool));
+  detection->work = aligned_alloc(64, allocationStride * sizeof(int));
+  if (detection->finish == NULL || detection->work == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate detection state.");
+    endDetection(detection);
+    return -1;
+  }
+
+  memcpy(detection->work, resourceAvailable, allocationStride * sizeof(int));
+  memset(detection->finish, 0, processSlots * sizeof(bool));
+  detection->unfinished =
+      detectionPass(detection->finish, detection->work, processSlots);
+  return detection->unfinished;
+}
+
+// Treats the unfinished process in slot index as gone: its allocations go
+// back into work and only the processes still unfinished are rechecked.
+// Call before the victim's row is cleared. Returns the new unfinished count.
+int removeFromDetection(Detection *detection, int index) {
+  if (detection->finish[index])
+    return detection->unfinished;
+
+  detectionKernel()->rowAccumulate(detection->work, &ALLOCATED(index, 0),
+                                   allocationStride);
+  detection->finish[index] = true;
+  detection->unfinished = detectionPass(detection->finish, detection->work,
+                                        detection->unfinished - 1);
+  return detection->unfinished;
+}
+
+void endDetection(Detection *detection) {
+  free(detection->finish);
+  free(detection->work);
+  detection->finish = NULL;
+  detection->work = NULL;
+}
@@ -0,0 +1,83 @@
+#include "event.h"
+#include "shared.h"
+
+int initEventQueue(EventQueue *q, int capacity) {
+  if (capacity <= 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Invalid event queue capacity: %d.",
+                capacity);
+    return -1;
+  }
+
+  q->events = (SimEvent *)calloc(capacity, sizeof(SimEvent));
+  if (q->events == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate event queue.");
+    return -1;
+  }
+  q->size = 0;
+  q->capacity = capacity;
+  return 0;
+}
+
+void freeEventQueue(EventQueue *q) {
+  free(q->events);
+  q->events = NULL;
+  q->size = 0;
+  q->capacity = 0;
+}
+
+int pushEvent(EventQueue *q, SimEvent event) {
+  if (q->size == q->capacity) {
+    int capacity = q->capacity * 2;
+    SimEvent *events =
+        (SimEvent *)realloc(q->events, capacity * sizeof(SimEvent));
+    if (events == NULL) {
+      log_message(LOG_LEVEL_ERROR, 0, "Failed to grow event queue to %d.",
+                  capacity);
+      return -1;
+    }
+    q->events = events;
+    q->capacity = capacity;
+  }
+
+  // Sift up
+  int i = q->size++;
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (q->events[parent].time <= event.time)
+      break;
+    q->events[i] = q->events[parent];
+    i = parent;
+  }
+  q->events[i] = event;
+  return 0;
+}
+
+int popEvent(EventQueue *q, SimEvent *event) {
+  if (q->size == 0)
+    return -1;
+
+  *event = q->events[0];
+  SimEvent last = q->events[--q->size];
+
+  // Sift down
+  int i = 0;
+  while (true) {
+    int child = 2 * i + 1;
+    if (child >= q->size)
+      break;
+    if (child + 1 < q->size &&
+        q->events[child + 1].time < q->events[child].time)
+      child++;
+    if (last.time <= q->events[child].time)
+      break;
+    q->events[i] = q->events[child];
+    i = child;
+  }
+  if (q->size > 0)
+    q->events[i] = last;
+  return 0;
+}
+
+const SimEvent *peekEvent(const EventQueue *q) {
+  return q->size > 0 ? &q->events[0] : NULL;
+}
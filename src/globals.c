@@ -3,9 +3,17 @@
 int maxResources = DEFAULT_MAX_RESOURCES;
 int maxProcesses = DEFAULT_MAX_PROCESSES;
 int maxInstances = DEFAULT_MAX_INSTANCES;
+int maxSimultaneous = DEFAULT_MAX_SIMULTANEOUS;
+int processSlots = DEFAULT_MAX_SIMULTANEOUS; // Process table rows, see init.c
 int launchInterval = DEFAULT_LAUNCH_INTERVAL;
+TransportType transportType = TRANSPORT_MSQ; // Worker->psmgmt message path
+WorkerRuntime workerRuntime = RUNTIME_PROCESS; // -w: processes or threads
+bool discreteEvents = false; // Jump the clock between scheduled events
+bool avoidDeadlocks = false; // Banker's check on every grant
+int poolSize = 0; // Workers spawned ahead of time and parked until launched
 char logFileName[256] = DEFAULT_LOG_FILE_NAME;
 FILE *logFile = NULL;
+char traceFileName[256] = ""; // -e: binary event trace, off when empty
 
 // Global variables to represent different process and system states
 ProcessType gProcessType; // Current process type
@@ -15,6 +23,7 @@ struct timeval lastLogTime; // Last log entry time
 SimulatedClock *simClock = NULL; // Pointer to simulated system clock
 ActualTime *actualTime = NULL;   // Pointer to actual time for processes
 
+TableHeader *tableHeader = NULL; // Shared segment holding all tables
 PCB *processTable; // Pointer to process control block table
 
 pthread_mutex_t processTableMutex = PTHREAD_MUTEX_INITIALIZER;
@@ -24,8 +33,7 @@ int msqId = -1; // Message queue identifier
 // Shared memory identifiers for various components
 int simulatedTimeShmId = -1; // Simulated time shared memory ID
 int actualTimeShmId = -1;    // Actual time shared memory ID
-int processTableShmId = -1;  // Process table shared memory ID
-int resourceTableShmId = -1; // Resource table shared memory ID
+int processTableShmId = -1;  // Table segment shared memory ID
 int deadlockShmId = -1;      // Deadlock detection shared memory ID
 
 // Volatile variables for process control
@@ -40,7 +48,7 @@ int currentChildren = 0; // Current number of child processes
 
 int totalLaunched = 0;
 
-int currentLogLevel = LOG_LEVEL_DEBUG; // Current log level
+int currentLogLevel = LOG_LEVEL_INFO; // Current log level, set with -l
 
 sem_t *clockSem = SEM_FAILED; // Semaphore for clock synchronization
 const char *clockSemName = "/simClockSem"; // Name of the clock semaphore
@@ -0,0 +1,65 @@
+#include "histogram.h"
+
+// Bucket holding value: exact below HISTOGRAM_SUB_BUCKETS, then
+// HISTOGRAM_SUB_BUCKETS per power of two
+int histogramBucket(uint64_t value) {
+  if (value < HISTOGRAM_SUB_BUCKETS)
+    return (int)value;
+
+  int top = 63 - __builtin_clzll(value); // Highest set bit, >= SUB_BITS
+  if (top >= HISTOGRAM_MAX_BITS)
+    return HISTOGRAM_BUCKETS - 1;
+  int shift = top - HISTOGRAM_SUB_BITS;
+  return (shift + 1) * HISTOGRAM_SUB_BUCKETS +
+         (int)(value >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+// Largest value that lands in bucket
+uint64_t histogramBucketHighest(int bucket) {
+  if (bucket < HISTOGRAM_SUB_BUCKETS)
+    return (uint64_t)bucket;
+
+  int shift = bucket / HISTOGRAM_SUB_BUCKETS - 1;
+  uint64_t lowest = (uint64_t)(HISTOGRAM_SUB_BUCKETS +
+                               bucket % HISTOGRAM_SUB_BUCKETS)
+                    << shift;
+  return lowest + (1ULL << shift) - 1;
+}
+
+void histogramRecord(Histogram *histogram, uint64_t value) {
+  atomic_fetch_add_explicit(&histogram->buckets[histogramBucket(value)], 1,
+                            memory_order_relaxed);
+  atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+
+  uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+  while (value > max &&
+         !atomic_compare_exchange_weak_explicit(&histogram->max, &max, value,
+                                                memory_order_relaxed,
+                                                memory_order_relaxed)) {
+  }
+}
+
+// Value at or below which percentile percent of the recorded values fall,
+// reported as its bucket's highest value but never above the exact max.
+// 0 for an empty histogram.
+uint64_t histogramPercentile(const Histogram *histogram, double percentile) {
+  uint64_t count =
+      atomic_load_explicit(&histogram->count, memory_order_relaxed);
+  uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+  if (count == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+    seen += atomic_load_explicit(&histogram->buckets[bucket],
+                                 memory_order_relaxed);
+    if (seen >= rank) {
+      uint64_t highest = histogramBucketHighest(bucket);
+      return highest < max ? highest : max;
+    }
+  }
+  return max;
+}
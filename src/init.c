@@ -1,8 +1,9 @@
 #include "init.h"
+#include "process.h"
 
 int initializeResourceQueues(void) {
-  for (int i = 0; i < MAX_RESOURCES; i++) {
-    if (initQueue(&resourceQueues[i], MAX_RESOURCES) == -1) {
+  for (int i = 0; i < maxResources; i++) {
+    if (initQueue(&resourceQueues[i], maxSimultaneous + 1) == -1) {
       log_message(LOG_LEVEL_ERROR, 0,
                   "Failed to initialize resource queue for resource %d", i);
       return -1;
@@ -59,42 +60,127 @@ int initializeClockAndTime(void) {
   return SUCCESS;
 }
 
+static size_t alignTable(size_t offset) {
+  return (offset + 63) & ~(size_t)63; // Keep each table on its own cache line
+}
+
+static int padToCacheLine(int count) {
+  return (count + CACHE_LINE_INTS - 1) & ~(CACHE_LINE_INTS - 1);
+}
+
+// Points the table globals into an attached segment
+static void mapTables(TableHeader *header) {
+  tableHeader = header;
+  processTable = (PCB *)((char *)header + header->processTableOffset);
+  resourceTotal = (int *)((char *)header + header->totalOffset);
+  resourceAvailable = (int *)((char *)header + header->availableOffset);
+  allocationMatrix = (int *)((char *)header + header->allocationOffset);
+  claimMatrix = (int *)((char *)header + header->claimOffset);
+  allocationStride = header->allocationStride;
+}
+
 int initializeResourceTable(void) {
   log_message(LOG_LEVEL_DEBUG, 0, "Attempting to initialize resource table...");
 
-  resourceTable = (ResourceDescriptor *)attachSharedMemory(
-      SHM_PATH, SHM_PROJ_ID_RESOURCE_TABLE,
-      sizeof(ResourceDescriptor) * MAX_RESOURCES, "Resource Table");
-
-  if (resourceTable == NULL) {
+  if (tableHeader == NULL) {
     log_message(LOG_LEVEL_ERROR, 0,
-                "Failed to attach to resource table shared memory.");
+                "Resource table is part of the process table segment; "
+                "initialize that first.");
     return -1;
   }
 
-  log_message(LOG_LEVEL_DEBUG, 0,
-              "Attached to resource table shared memory successfully.");
-
-  for (int i = 0; i < MAX_RESOURCES; i++) {
-    resourceTable[i].total = maxInstances;
-    resourceTable[i].available = maxInstances;
-    memset(resourceTable[i].allocated, 0, sizeof(resourceTable[i].allocated));
+  for (int i = 0; i < maxResources; i++) {
+    resourceTotal[i] = maxInstances;
+    resourceAvailable[i] = maxInstances;
     log_message(LOG_LEVEL_DEBUG, 0,
                 "Resource %d initialized: total=%d, available=%d.", i,
-                resourceTable[i].total, resourceTable[i].available);
+                resourceTotal[i], resourceAvailable[i]);
   }
+  memset(allocationMatrix, 0,
+         (size_t)processSlots * allocationStride * sizeof(int));
+  memset(claimMatrix, 0,
+         (size_t)processSlots * allocationStride * sizeof(int));
+  freeSafetyState(); // Rebuilt from the cleared matrices when next needed
 
   log_message(LOG_LEVEL_DEBUG, 0, "Resource table initialized successfully.");
   return SUCCESS;
 }
 
+// Rows the process table needs: slots are recycled once a process is
+// reaped, so only running children and parked pool workers hold one
+static int slotsNeeded(void) {
+  int slots = maxSimultaneous;
+  if (workerRuntime == RUNTIME_PROCESS)
+    slots += poolSize;
+  return slots < maxProcesses ? slots : maxProcesses;
+}
+
+// Creates the segment holding the process table, resource vectors, the
+// allocation matrix and the claim matrix, sized from
+// processSlots and maxResources
 int initializeProcessTable(void) {
-  processTable =
-      (PCB *)attachSharedMemory(SHM_PATH, SHM_PROJ_ID_PROCESS_TABLE,
-                                maxProcesses * sizeof(PCB), "Process Table");
-  if (processTable == NULL)
+  if (tableHeader != NULL) {
+    shmdt(tableHeader); // Re-initialization, start from a fresh segment
+    tableHeader = NULL;
+  }
+
+  processSlots = slotsNeeded();
+
+  int rowInts = padToCacheLine(maxResources);
+  size_t processTableOffset = alignTable(sizeof(TableHeader));
+  size_t totalOffset =
+      alignTable(processTableOffset + (size_t)processSlots * sizeof(PCB));
+  size_t availableOffset = totalOffset + (size_t)rowInts * sizeof(int);
+  size_t allocationOffset = availableOffset + (size_t)rowInts * sizeof(int);
+  size_t claimOffset =
+      allocationOffset + (size_t)processSlots * rowInts * sizeof(int);
+  size_t size = claimOffset + (size_t)processSlots * rowInts * sizeof(int);
+
+  TableHeader *header = (TableHeader *)createSharedMemory(
+      SHM_PATH, SHM_PROJ_ID_TABLES, size, "Process Table", &processTableShmId);
+  if (header == NULL)
+    return ERROR_INIT_SHM;
+
+  header->processSlots = processSlots;
+  header->resourceCount = maxResources;
+  header->maxInstances = maxInstances;
+  header->maxSimultaneous = maxSimultaneous;
+  header->claimsRequired = avoidDeadlocks;
+  header->logLevel = currentLogLevel;
+  header->allocationStride = rowInts;
+  header->processTableOffset = processTableOffset;
+  header->totalOffset = totalOffset;
+  header->availableOffset = availableOffset;
+  header->allocationOffset = allocationOffset;
+  header->claimOffset = claimOffset;
+  header->size = size;
+  mapTables(header);
+
+  return rebuildProcessIndex();
+}
+
+int attachTables(void) {
+  int shmId = shmget(getSharedMemoryKey(SHM_PATH, SHM_PROJ_ID_TABLES), 0, 0);
+  if (shmId == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Process table not found: %s",
+                strerror(errno));
     return ERROR_INIT_SHM;
+  }
+
+  TableHeader *header = (TableHeader *)shmat(shmId, NULL, 0);
+  if (header == (void *)-1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to attach process table: %s",
+                strerror(errno));
+    return ERROR_INIT_SHM;
+  }
 
+  processSlots = header->processSlots;
+  maxResources = header->resourceCount;
+  maxInstances = header->maxInstances;
+  maxSimultaneous = header->maxSimultaneous;
+  avoidDeadlocks = header->claimsRequired;
+  currentLogLevel = header->logLevel;
+  mapTables(header);
   return SUCCESS;
 }
 
@@ -0,0 +1,248 @@
+#include "logring.h"
+#include "ring.h"
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <sys/syscall.h>
+
+typedef struct {
+  _Atomic unsigned long sequence; // Slot index when free, +1 once published
+  int logToFile;
+  int length;
+  char text[LOG_BUFFER_SIZE];
+} LogRecord;
+
+typedef struct {
+  _Alignas(CACHE_LINE_SIZE) _Atomic unsigned long enqueuePos; // Producers
+  _Alignas(CACHE_LINE_SIZE) unsigned long dequeuePos;         // Flusher only
+  _Alignas(CACHE_LINE_SIZE) _Atomic unsigned int wakeups; // Futex word
+  _Atomic bool flusherSleeping;
+  _Atomic bool stopping;
+  _Atomic unsigned long dropped; // Records refused because the ring was full
+  _Atomic unsigned long stalled; // Warnings and errors that waited for room
+  LogRecord records[LOG_RING_SLOTS];
+} LogRing;
+
+static LogRing *logRing = NULL;
+static _Atomic bool logRingActive = false;
+static pthread_t flusherThread;
+
+// Output gathered by the flusher between writes
+static char stderrBuffer[LOG_FLUSH_BUFFER];
+static size_t stderrUsed = 0;
+static char fileBuffer[LOG_FLUSH_BUFFER];
+static size_t fileUsed = 0;
+
+static void writeAll(int fd, const char *data, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, data, length);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      return;
+    }
+    data += written;
+    length -= written;
+  }
+}
+
+static void flushOutput(void) {
+  if (stderrUsed > 0) {
+    writeAll(STDERR_FILENO, stderrBuffer, stderrUsed);
+    stderrUsed = 0;
+  }
+  if (fileUsed > 0 && logFile != NULL) {
+    fwrite(fileBuffer, 1, fileUsed, logFile);
+    fflush(logFile);
+  }
+  fileUsed = 0;
+}
+
+static void appendOutput(const char *text, int length, int logToFile) {
+  if (stderrUsed + length + 1 > LOG_FLUSH_BUFFER ||
+      fileUsed + length + 1 > LOG_FLUSH_BUFFER) {
+    flushOutput();
+  }
+  memcpy(stderrBuffer + stderrUsed, text, length);
+  stderrUsed += length;
+  stderrBuffer[stderrUsed++] = '\n';
+  if (logToFile) {
+    memcpy(fileBuffer + fileUsed, text, length);
+    fileUsed += length;
+    fileBuffer[fileUsed++] = '\n';
+  }
+}
+
+// Moves every published record into the output buffers. Returns how many.
+static int drainLogRing(void) {
+  int drained = 0;
+  for (;;) {
+    LogRecord *record = &logRing->records[logRing->dequeuePos &
+                                          (LOG_RING_SLOTS - 1)];
+    unsigned long sequence =
+        atomic_load_explicit(&record->sequence, memory_order_acquire);
+    if (sequence != logRing->dequeuePos + 1)
+      break; // Empty, or the next producer has not published yet
+
+    appendOutput(record->text, record->length, record->logToFile);
+    atomic_store_explicit(&record->sequence,
+                          logRing->dequeuePos + LOG_RING_SLOTS,
+                          memory_order_release);
+    logRing->dequeuePos++;
+    drained++;
+  }
+  return drained;
+}
+
+static void reportDrops(unsigned long *reported) {
+  unsigned long dropped = atomic_load(&logRing->dropped);
+  if (dropped == *reported)
+    return;
+
+  char line[128];
+  int length = snprintf(line, sizeof(line),
+                        "[psmgmt] Log ring full, dropped %lu records",
+                        dropped - *reported);
+  appendOutput(line, length, 1);
+  *reported = dropped;
+}
+
+static void *runLogFlusher(void *arg) {
+  (void)arg;
+  unsigned long reported = 0;
+  struct timespec idle = {0, LOG_FLUSH_IDLE_NS};
+
+  while (!atomic_load(&logRing->stopping)) {
+    if (drainLogRing() > 0)
+      continue; // Keep gathering while producers are busy
+
+    reportDrops(&reported);
+    flushOutput();
+
+    // Sleep until a producer kicks us; the timeout covers a kick that
+    // raced the flag
+    unsigned int wakeups = atomic_load(&logRing->wakeups);
+    atomic_store(&logRing->flusherSleeping, true);
+    if (atomic_load_explicit(
+            &logRing->records[logRing->dequeuePos & (LOG_RING_SLOTS - 1)]
+                 .sequence,
+            memory_order_acquire) != logRing->dequeuePos + 1) {
+      syscall(SYS_futex, &logRing->wakeups, FUTEX_WAIT_PRIVATE, wakeups,
+              &idle, NULL, 0);
+    }
+    atomic_store(&logRing->flusherSleeping, false);
+  }
+
+  drainLogRing();
+  reportDrops(&reported);
+  flushOutput();
+  return NULL;
+}
+
+// Starts the flusher; from here on log_message() only enqueues
+int startLogFlusher(void) {
+  logRing = aligned_alloc(CACHE_LINE_SIZE, sizeof(LogRing));
+  if (logRing == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate the log ring.");
+    return -1;
+  }
+  memset(logRing, 0, sizeof(LogRing));
+  for (unsigned long i = 0; i < LOG_RING_SLOTS; i++) {
+    atomic_init(&logRing->records[i].sequence, i);
+  }
+
+  // The flusher blocks every signal, so handlers keep running on the caller
+  sigset_t all, previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+  int error = pthread_create(&flusherThread, NULL, runLogFlusher, NULL);
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if (error != 0) {
+    free(logRing);
+    logRing = NULL;
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to start the log flusher: %s",
+                strerror(error));
+    return -1;
+  }
+
+  atomic_store(&logRingActive, true);
+  return 0;
+}
+
+// Writes out everything still queued and returns to synchronous logging.
+// A record whose producer was interrupted before publishing it is lost.
+void stopLogFlusher(void) {
+  if (!atomic_exchange(&logRingActive, false))
+    return;
+
+  atomic_store(&logRing->stopping, true);
+  atomic_fetch_add(&logRing->wakeups, 1);
+  syscall(SYS_futex, &logRing->wakeups, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+  pthread_join(flusherThread, NULL);
+
+  unsigned long dropped = atomic_load(&logRing->dropped);
+  unsigned long stalled = atomic_load(&logRing->stalled);
+  free(logRing);
+  logRing = NULL;
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Log flusher stopped: %lu records dropped, %lu writers stalled.",
+              dropped, stalled);
+}
+
+// Queues one formatted line. Returns false if the flusher is not running
+// and the caller has to write the line itself. When the ring is full,
+// warnings and errors wait for room, up to LOG_STALL_YIELDS yields, and
+// anything less is dropped. The bound keeps a producer from spinning
+// forever on a slot whose owner was interrupted before publishing it.
+bool logRingPush(int level, int logToFile, const char *text, int length) {
+  if (!atomic_load_explicit(&logRingActive, memory_order_acquire))
+    return false;
+
+  if (length > LOG_BUFFER_SIZE - 1)
+    length = LOG_BUFFER_SIZE - 1;
+
+  int yields = 0;
+  unsigned long position = atomic_load_explicit(&logRing->enqueuePos,
+                                                memory_order_relaxed);
+  LogRecord *record;
+  for (;;) {
+    record = &logRing->records[position & (LOG_RING_SLOTS - 1)];
+    unsigned long sequence =
+        atomic_load_explicit(&record->sequence, memory_order_acquire);
+    long difference = (long)(sequence - position);
+    if (difference == 0) {
+      if (atomic_compare_exchange_weak_explicit(
+              &logRing->enqueuePos, &position, position + 1,
+              memory_order_relaxed, memory_order_relaxed))
+        break;
+    } else if (difference < 0) {
+      // Full
+      if (level < LOG_LEVEL_WARN || yields == LOG_STALL_YIELDS) {
+        atomic_fetch_add(&logRing->dropped, 1);
+        return true;
+      }
+      if (yields++ == 0)
+        atomic_fetch_add(&logRing->stalled, 1);
+      sched_yield();
+      position = atomic_load_explicit(&logRing->enqueuePos,
+                                      memory_order_relaxed);
+    } else {
+      position = atomic_load_explicit(&logRing->enqueuePos,
+                                      memory_order_relaxed);
+    }
+  }
+
+  memcpy(record->text, text, length);
+  record->length = length;
+  record->logToFile = logToFile;
+  atomic_store_explicit(&record->sequence, position + 1, memory_order_release);
+
+  // Only the first producer to find the flusher asleep pays for the wake
+  if (atomic_load_explicit(&logRing->flusherSleeping, memory_order_relaxed) &&
+      atomic_exchange(&logRing->flusherSleeping, false)) {
+    atomic_fetch_add(&logRing->wakeups, 1);
+    syscall(SYS_futex, &logRing->wakeups, FUTEX_WAKE_PRIVATE, 1, NULL, NULL,
+            0);
+  }
+  return true;
+}
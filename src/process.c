@@ -1,13 +1,135 @@
 #include "process.h"
+#include "init.h"
+#include "reactor.h"
+#include "ring.h"
+#include "simclock.h"
 
-void registerChildProcess(pid_t pid) {
+#include <spawn.h>
+
+extern char **environ;
+
+// psmgmt-private lookup structures over the shared process table. A slot is
+// freed when its process is reaped and handed to a later launch, so entries
+// leave the pid index by backward shifting rather than tombstones.
+static int *pidIndexSlots = NULL; // Open-addressing pid -> slot, -1 = empty
+static pid_t *pidIndexKeys = NULL;
+static int pidIndexCapacity = 0; // Power of two, at least 2 * processSlots
+static int pidIndexCount = 0;
+static int *freeSlots = NULL; // Stack of unoccupied slots
+static int freeSlotCount = 0;
+
+static unsigned int hashPid(pid_t pid) {
+  return ((unsigned int)pid * 2654435761u) & (pidIndexCapacity - 1);
+}
+
+// The index never holds more pids than there are slots, so it stays at
+// most half full and a probe always ends at an empty bucket
+static void indexProcess(pid_t pid, int index) {
+  if (pidIndexCapacity == 0)
+    return;
+
+  unsigned int h = hashPid(pid);
+  while (pidIndexSlots[h] != -1 && pidIndexKeys[h] != pid) {
+    h = (h + 1) & (pidIndexCapacity - 1);
+  }
+  if (pidIndexSlots[h] == -1) {
+    pidIndexCount++;
+  }
+  pidIndexKeys[h] = pid;
+  pidIndexSlots[h] = index;
+}
+
+static void unindexProcess(pid_t pid) {
+  if (pidIndexCapacity == 0)
+    return;
+
+  unsigned int mask = pidIndexCapacity - 1;
+  unsigned int hole = hashPid(pid);
+  while (pidIndexSlots[hole] != -1 && pidIndexKeys[hole] != pid) {
+    hole = (hole + 1) & mask;
+  }
+  if (pidIndexSlots[hole] == -1)
+    return;
+  pidIndexSlots[hole] = -1;
+  pidIndexCount--;
+
+  // Pull later entries of the probe run back over the hole if their home
+  // bucket does not lie between the hole and where they sit
+  for (unsigned int next = (hole + 1) & mask; pidIndexSlots[next] != -1;
+       next = (next + 1) & mask) {
+    unsigned int home = hashPid(pidIndexKeys[next]);
+    if (((next - home) & mask) < ((next - hole) & mask))
+      continue;
+    pidIndexKeys[hole] = pidIndexKeys[next];
+    pidIndexSlots[hole] = pidIndexSlots[next];
+    pidIndexSlots[next] = -1;
+    hole = next;
+  }
+}
+
+int rebuildProcessIndex(void) {
+  int capacity = 16;
+  while (capacity < 2 * processSlots) {
+    capacity <<= 1;
+  }
+
+  if (capacity != pidIndexCapacity) {
+    int *slots = realloc(pidIndexSlots, capacity * sizeof(int));
+    pid_t *keys = realloc(pidIndexKeys, capacity * sizeof(pid_t));
+    int *stack = realloc(freeSlots, capacity * sizeof(int));
+    if (slots != NULL)
+      pidIndexSlots = slots;
+    if (keys != NULL)
+      pidIndexKeys = keys;
+    if (stack != NULL)
+      freeSlots = stack;
+    if (slots == NULL || keys == NULL || stack == NULL) {
+      log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate process index.");
+      pidIndexCapacity = 0;
+      return -1;
+    }
+    pidIndexCapacity = capacity;
+  }
+
+  memset(pidIndexSlots, -1, capacity * sizeof(int));
+  pidIndexCount = 0;
+  freeSlotCount = 0;
+  for (int i = processSlots - 1; i >= 0; i--) {
+    if (processTable[i].occupied) {
+      indexProcess(processTable[i].pid, i);
+    } else {
+      freeSlots[freeSlotCount++] = i;
+    }
+  }
+  return SUCCESS;
+}
+
+void freeProcessIndex(void) {
+  free(pidIndexSlots);
+  free(pidIndexKeys);
+  free(freeSlots);
+  pidIndexSlots = NULL;
+  pidIndexKeys = NULL;
+  freeSlots = NULL;
+  pidIndexCapacity = pidIndexCount = freeSlotCount = 0;
+}
+
+static int registerProcess(pid_t pid, int state) {
   int index = findFreeProcessTableEntry();
   if (index != -1) {
+    unsigned long currentSec, currentNano;
+    readClock(simClock, &currentSec, &currentNano);
+
     processTable[index].pid = pid;
     processTable[index].occupied = 1;
-    processTable[index].state = PROCESS_RUNNING;
-    processTable[index].startSeconds = simClock->seconds;
-    processTable[index].startNano = simClock->nanoseconds;
+    processTable[index].state = state;
+    processTable[index].startSeconds = currentSec;
+    processTable[index].startNano = currentNano;
+    processTable[index].blocked = WORKER_BUSY;
+    processTable[index].victimsTaken = 0;
+    memset(&CLAIMED(index, 0), 0, maxResources * sizeof(int));
+    indexProcess(pid, index);
+    assignRing(index, pid);
     log_message(LOG_LEVEL_DEBUG, 0,
                 "Registered child process with PID %d at index %d", pid, index);
   } else {
@@ -17,6 +139,46 @@ void registerChildProcess(pid_t pid) {
         pid);
     kill(pid, SIGTERM); // Gracefully terminate the child process
   }
+  return index;
+}
+
+void registerChildProcess(pid_t pid) { registerProcess(pid, PROCESS_RUNNING); }
+
+// Gives a pool worker its slot up front; it stays parked until activated.
+// Returns the slot, or -1.
+int registerPooledProcess(pid_t pid) {
+  return registerProcess(pid, PROCESS_POOLED);
+}
+
+// Launches the pooled worker in slot index: it starts now, and the store to
+// its state is what wakes it
+void activatePooledProcess(int index) {
+  PCB *pcb = &processTable[index];
+  unsigned long currentSec, currentNano;
+  readClock(simClock, &currentSec, &currentNano);
+
+  pcb->startSeconds = currentSec;
+  pcb->startNano = currentNano;
+  atomic_store(&pcb->blocked, WORKER_BUSY);
+  atomic_store(&pcb->state, PROCESS_RUNNING);
+  syscall(SYS_futex, &pcb->state, FUTEX_WAKE, 1, NULL, NULL, 0);
+  log_message(LOG_LEVEL_DEBUG, 0, "Activated pooled process %d at index %d",
+              pcb->pid, index);
+}
+
+// Worker side of the pool. Returns 0 once psmgmt launches us, or -1 if we
+// are told to stop or psmgmt goes away first.
+int waitForActivation(PCB *slot) {
+  pid_t parent = getppid();
+  struct timespec timeout = {0, POOL_WAIT_TIMEOUT_NS};
+
+  while (keepRunning && getppid() == parent) {
+    if (atomic_load(&slot->state) != PROCESS_POOLED)
+      return 0;
+    syscall(SYS_futex, &slot->state, FUTEX_WAIT, PROCESS_POOLED, &timeout,
+            NULL, 0);
+  }
+  return -1;
 }
 
 int findFreeProcessTableEntry(void) {
@@ -25,26 +187,36 @@ int findFreeProcessTableEntry(void) {
     return -1; // Indicate failure
   }
 
-  for (int i = 0; i < maxProcesses; i++) {
-    if (!processTable[i].occupied) {
-      log_message(LOG_LEVEL_DEBUG, 0,
-                  "Found free process table entry at index %d", i);
-      return i;
-    }
+  if (freeSlotCount == 0) {
+    log_message(LOG_LEVEL_WARN, 0, "No free process table entries found.");
+    return -1;
   }
-  log_message(LOG_LEVEL_WARN, 0, "No free process table entries found.");
-  return -1;
+  int index = freeSlots[--freeSlotCount];
+  log_message(LOG_LEVEL_DEBUG, 0, "Found free process table entry at index %d",
+              index);
+  return index;
 }
 
-pid_t forkAndExecute(const char *executable) {
-  pid_t pid = fork();
-  if (pid == 0) {
-    execl(executable, executable, (char *)NULL);
-    perror("Failed to execute child process");
-    exit(EXIT_FAILURE);
-  } else if (pid < 0) {
-    perror("Failed to fork child process");
-    exit(EXIT_FAILURE);
+// posix_spawn() (a vfork-style clone in glibc) starts the worker without
+// copying the page tables of psmgmt, which are large under ASan
+pid_t spawnWorker(const char *executable, bool pooled) {
+  char *argv[] = {(char *)executable, pooled ? POOLED_WORKER_ARG : NULL, NULL};
+  posix_spawnattr_t attr;
+  sigset_t mask;
+  pid_t pid;
+
+  // psmgmt blocks SIGCHLD for its signalfd; don't pass that on
+  sigemptyset(&mask);
+  posix_spawnattr_init(&attr);
+  posix_spawnattr_setsigmask(&attr, &mask);
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+  int error = posix_spawn(&pid, executable, NULL, &attr, argv, environ);
+  posix_spawnattr_destroy(&attr);
+
+  if (error != 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to spawn %s: %s", executable,
+                strerror(error));
+    return -1;
   }
   return pid;
 }
@@ -83,15 +255,21 @@ const char *processStateToString(int state) {
     return "Waiting";
   case PROCESS_TERMINATED:
     return "Terminated";
+  case PROCESS_POOLED:
+    return "Pooled";
   default:
     return "Unknown";
   }
 }
 
+// Frees the slot of a reaped process for the next launch. The pid stays in
+// the entry, marked terminated, so table dumps show it until then.
 void clearProcessEntry(int index) {
-  if (index >= 0 && index < MAX_SIMULTANEOUS && processTable[index].occupied) {
-    processTable[index].occupied = 1;
+  if (index >= 0 && index < processSlots && processTable[index].occupied) {
+    unindexProcess(processTable[index].pid);
+    processTable[index].occupied = 0;
     processTable[index].state = PROCESS_TERMINATED;
+    freeSlots[freeSlotCount++] = index;
     log_message(LOG_LEVEL_INFO, 0, "Process terminated at table entry index %d",
                 index);
   }
@@ -100,16 +278,15 @@ void clearProcessEntry(int index) {
 int killProcess(pid_t pid, int sig) { return kill(pid, sig); }
 
 int findProcessIndexByPID(pid_t pid) {
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    // log_message(LOG_LEVEL_INFO, 0, "Checking process table entry at index %d
-    // for PID %ld", i, pid);
-    if (processTable[i].occupied && processTable[i].pid == pid) {
-      log_message(LOG_LEVEL_DEBUG, 0,
-                  "Found process table entry for PID %ld at index %d", pid, i);
-      return i;
+  if (pidIndexCapacity > 0) {
+    unsigned int h = hashPid(pid);
+    while (pidIndexSlots[h] != -1) {
+      if (pidIndexKeys[h] == pid)
+        return pidIndexSlots[h];
+      h = (h + 1) & (pidIndexCapacity - 1);
     }
   }
-  log_message(LOG_LEVEL_DEBUG, 0, "No process table entry found for PID %ld",
+  log_message(LOG_LEVEL_DEBUG, 0, "No process table entry found for PID %d",
               pid);
 
   return -1;
@@ -122,7 +299,7 @@ void logProcessTable() {
       LOG_LEVEL_INFO, 0,
       " Index | PID    | State        | Start Time   | Blocked | Block Until");
 
-  for (int i = 0; i < maxProcesses; i++) {
+  for (int i = 0; i < processSlots; i++) {
     if (processTable[i].occupied ||
         processTable[i].state == PROCESS_TERMINATED) {
       char startTime[64], blockTime[64];
@@ -146,3 +323,40 @@ void logProcessTable() {
   log_message(LOG_LEVEL_INFO, 0,
               "------------------------------------------------");
 }
+
+PCB *attachWorkerSlot(pid_t pid) {
+  if (processTable == NULL && attachTables() != SUCCESS) {
+    return NULL;
+  }
+
+  // psmgmt registers us right after the fork, give it a moment
+  for (int attempt = 0; attempt < 1000; attempt++) {
+    for (int i = 0; i < processSlots; i++) {
+      if (processTable[i].occupied && processTable[i].pid == pid &&
+          (processTable[i].state == PROCESS_RUNNING ||
+           processTable[i].state == PROCESS_POOLED)) {
+        return &processTable[i];
+      }
+    }
+    usleep(1000);
+  }
+  log_message(LOG_LEVEL_ERROR, 0, "Worker %d: no process table slot.", pid);
+  return NULL;
+}
+
+void parkWorker(PCB *slot, unsigned long wakeAt) {
+  slot->eventBlockedUntilSec = wakeAt / NANOSECONDS_IN_SECOND;
+  slot->eventBlockedUntilNano = wakeAt % NANOSECONDS_IN_SECOND;
+  atomic_store(&slot->blocked, WORKER_PARKED); // Publishes the wake time
+  notifyMaster();
+}
+
+bool allWorkersParked(void) {
+  for (int i = 0; i < processSlots; i++) {
+    if (processTable[i].occupied && processTable[i].state == PROCESS_RUNNING &&
+        atomic_load(&processTable[i].blocked) == WORKER_BUSY) {
+      return false;
+    }
+  }
+  return true;
+}
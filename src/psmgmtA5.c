@@ -1,48 +1,88 @@
 #include "arghandler.h"
 #include "cleanup.h"
+#include "event.h"
 #include "globals.h"
 #include "init.h"
+#include "logring.h"
 #include "process.h"
 #include "queue.h"
+#include "recovery.h"
+#include "reactor.h"
 #include "resource.h"
+#include "ring.h"
 #include "shared.h"
 #include "signals.h"
+#include "simclock.h"
+#include "stats.h"
+#include "tasks.h"
 #include "timeutils.h"
+#include "trace.h"
 #include "user_process.h"
+#include "waitgraph.h"
 
-#define ACTION_INTERVAL_NS 250000000L // Action interval in nanoseconds (250ms)
+#define MESSAGE_BUDGET 64 // Messages handled per pass; any more wait a pass
+#define EVENT_POLL_MS 10 // Discrete-event mode: recheck busy workers this often
+#define WORKER_EXECUTABLE "./workerA5"
+
+// Slots of pool workers parked until launchChild() needs one (-p)
+static int workerPool[MAX_SIMULTANEOUS];
+static int pooledWorkers = 0;
 
 void initializeSimulationEnvironment(void);
 void manageSimulation(void);
+void manageEventSimulation(void);
+void launchChild(void);
+void fillWorkerPool(void);
+bool refillWorkerPool(void);
+void drainWorkerPool(void);
+void scheduleParkedWorkers(EventQueue *events);
+void wakeDueWorkers(unsigned long time);
+unsigned long wakeTime(const PCB *pcb);
 void manageChildTerminations(void);
-void manageResourceRequests(void);
+void reapChild(pid_t pid);
+bool manageResourceRequests(void);
+int receiveBatch(MessageA5 *batch, int maxMessages);
+void handleResourceBatch(const MessageA5 *batch, int count);
+void answerResourceMessage(const MessageA5 *msg, int result);
+int groupOf(const MessageA5 *msg);
+bool enqueueWaiter(int index, const MessageA5 *msg);
+void sendReply(const MessageA5 *request, int count, int status);
+void resolveDeadlockFrom(int index);
+void grantWaitingRequests(void);
+void grantFromQueue(Queue *q, int resourceType);
+void wakeWaiter(int index, const MessageA5 *request, int count, int status);
+void removeQueuedRequest(pid_t pid, int resourceType);
+void notifyVictim(int index);
 bool shouldLaunchNextChild(void);
 
 void displaySharedMemoryTimes(void) {
-  if (better_sem_wait(clockSem) == 0) {
-    log_message(LOG_LEVEL_DEBUG, 0,
-                "Simulated Time: %ld seconds, %ld nanoseconds",
-                simClock->seconds, simClock->nanoseconds);
-    log_message(LOG_LEVEL_DEBUG, 0, "Actual Time: %ld seconds, %ld nanoseconds",
-                actualTime->seconds, actualTime->nanoseconds);
-    better_sem_post(clockSem);
-  } else {
-    log_message(
-        LOG_LEVEL_DEBUG, 0,
-        "Failed to acquire semaphore for accessing shared memory times.");
-  }
+  unsigned long simSec, simNano, actSec, actNano;
+  readClock(simClock, &simSec, &simNano);
+  readClock(actualTime, &actSec, &actNano);
+
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Simulated Time: %lu seconds, %lu nanoseconds", simSec, simNano);
+  log_message(LOG_LEVEL_DEBUG, 0, "Actual Time: %lu seconds, %lu nanoseconds",
+              actSec, actNano);
 }
 
 int stillChildrenToLaunch(void) {
-  return totalLaunched < maxProcesses && currentChildren < MAX_SIMULTANEOUS;
+  return totalLaunched < maxProcesses && currentChildren < maxSimultaneous;
 }
 
 int main(int argc, char *argv[]) {
   setupParentSignalHandlers();
+
+  // Table sizes depend on the options, so parse them first
+  if (psmgmtArgs(argc, argv) != 0) {
+    exit(EXIT_FAILURE);
+  }
+
   semUnlinkCreate();
   initializeSharedResources();
 
-  if (initializeProcessTable() == -1 || initializeResourceTable() == -1) {
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initializeResourceQueues() == -1 || initWaitGraph() == -1) {
     log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
     exit(EXIT_FAILURE);
   }
@@ -51,13 +91,43 @@ int main(int argc, char *argv[]) {
 
   setupTimeout(MAX_RUNTIME);
 
-  if (psmgmtArgs(argc, argv) != 0) {
+  if (transportType == TRANSPORT_RING && initializeRingTransport() != SUCCESS) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize ring transport");
     exit(EXIT_FAILURE);
   }
 
   atexit(cleanupResources);
+  onDeadlockVictim = notifyVictim;
   initializeSimulationEnvironment();
-  manageSimulation();
+  if (startLogFlusher() != SUCCESS) {
+    log_message(LOG_LEVEL_WARN, 0, "Logging synchronously instead");
+  }
+  if (traceFileName[0] != '\0' && openTrace(traceFileName) != SUCCESS) {
+    exit(EXIT_FAILURE);
+  }
+  if (openStats() != SUCCESS) {
+    log_message(LOG_LEVEL_WARN, 0, "Running without live statistics");
+  }
+
+  if (initializeReactor(!discreteEvents) != SUCCESS) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize event loop");
+    exit(EXIT_FAILURE);
+  }
+
+  if (workerRuntime == RUNTIME_THREAD && initWorkerTasks() != SUCCESS) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize worker threads");
+    exit(EXIT_FAILURE);
+  }
+
+  simClock->eventDriven = discreteEvents;
+  fillWorkerPool();
+  if (discreteEvents) {
+    manageEventSimulation();
+  } else {
+    manageSimulation();
+  }
+  drainWorkerPool();
+  stopWorkerTasks();
   cleanupAndExit();
   return EXIT_SUCCESS;
 }
@@ -76,127 +146,605 @@ void initializeSimulationEnvironment(void) {
 }
 
 void manageSimulation(void) {
-  unsigned long lastResourceCheckTimeSec =
-      0; // For managing resources and deadlocks once per second
-  unsigned long lastLogTimeSec = 0;            // For logging twice per second
-  const unsigned long halfSecond = 500000000L; // Half second in nanoseconds
+  unsigned long nextTableDump = 0;    // Tables are logged twice per second
+  unsigned long nextDeadlockCheck = 0; // Deadlock detection once per second
+  bool backlog = false; // Messages were left over for the next pass
 
   while (keepRunning && (stillChildrenToLaunch() || currentChildren > 0)) {
-    manageChildTerminations();
-
-    if (shouldLaunchNextChild()) {
-      pid_t pid = forkAndExecute("./workerA5");
-      if (pid > 0) {
-        registerChildProcess(pid);
-        totalLaunched++;
-        currentChildren++;
-      }
+    unsigned long ticks;
+    unsigned int ready = waitForEvents(backlog ? 0 : -1, &ticks);
+
+    if ((ready & REACTOR_CHILD) || workerRuntime == RUNTIME_THREAD) {
+      manageChildTerminations();
+    }
+
+    // Inbound traffic is drained on every wakeup, not just on the eventfd
+    backlog = manageResourceRequests();
+
+    if (!(ready & REACTOR_TICK)) {
+      continue;
     }
 
-    simulateTimeProgression();
+    for (unsigned long i = 0; i < ticks; i++) {
+      simulateTimeProgression();
+    }
     trackActualTime();
+    publishStats(false);
+
+    if (stillChildrenToLaunch() && shouldLaunchNextChild()) {
+      launchChild();
+    }
+    refillWorkerPool();
 
-    better_sem_wait(clockSem);
-    unsigned long currentTimeSec = simClock->seconds;
-    unsigned long currentTimeNano = simClock->nanoseconds;
-    better_sem_post(clockSem);
+    unsigned long currentTimeSec, currentTimeNano;
+    readClock(simClock, &currentTimeSec, &currentTimeNano);
+    unsigned long now = currentTimeSec * ONE_SECOND + currentTimeNano;
 
     // Log resource and process tables twice per second
-    if ((currentTimeSec > lastLogTimeSec) ||
-        (currentTimeSec == lastLogTimeSec && currentTimeNano >= halfSecond &&
-         lastLogTimeSec * 1000000000L + halfSecond <= currentTimeNano)) {
-      lastLogTimeSec = currentTimeSec;
-      logResourceTable();
+    if (now >= nextTableDump) {
+      nextTableDump = now - now % HALF_SECOND + HALF_SECOND;
+      logResourceTableChanges();
       logProcessTable();
     }
 
-    manageResourceRequests();
-
-    // Manage resource requests and deadlock checking once per second
-    if (currentTimeSec > lastResourceCheckTimeSec) {
-      if (unsafeSystem()) { // Check for deadlocks only once per second
+    // Check for deadlocks once per simulated second
+    if (now >= nextDeadlockCheck) {
+      nextDeadlockCheck = now - now % ONE_SECOND + ONE_SECOND;
+      if (unsafeSystem()) {
         resolveDeadlocks();
+        grantWaitingRequests();
       }
 
       displaySharedMemoryTimes();
+    }
+  }
+
+  // Log final statistics before exiting
+  logStatistics();
+}
+
+// Discrete-event variant of manageSimulation(). Instead of ticking, the clock
+// jumps straight to the earliest pending event once every worker has parked.
+void manageEventSimulation(void) {
+  EventQueue events;
+  if (initEventQueue(&events, maxSimultaneous + 3) == -1) {
+    return;
+  }
+
+  unsigned long launchGap = (unsigned long)launchInterval * 1000000L;
+  pushEvent(&events, (SimEvent){.time = 0, .type = EVENT_LAUNCH});
+  pushEvent(&events, (SimEvent){.time = 0, .type = EVENT_TABLE_DUMP});
+  pushEvent(&events,
+            (SimEvent){.time = ONE_SECOND, .type = EVENT_DEADLOCK_CHECK});
 
-      lastResourceCheckTimeSec = currentTimeSec;
+  bool backlog = false;
+  while (keepRunning && (stillChildrenToLaunch() || currentChildren > 0)) {
+    unsigned long ticks;
+    bool idle = allWorkersParked();
+    unsigned int ready =
+        waitForEvents(idle || backlog ? 0 : EVENT_POLL_MS, &ticks);
+
+    if ((ready & REACTOR_CHILD) || workerRuntime == RUNTIME_THREAD) {
+      manageChildTerminations();
+    }
+    backlog = manageResourceRequests();
+    trackActualTime();
+    publishStats(false);
+    refillWorkerPool();
+
+    if (!allWorkersParked()) {
+      continue; // Someone is still acting at the current time
     }
+    scheduleParkedWorkers(&events);
 
-    // Calculate the sleep time based on elapsed time since the last action
-    unsigned long elapsedNanoSinceLastAction =
-        (currentTimeSec - lastResourceCheckTimeSec) * 1000000000L +
-        currentTimeNano;
-    long sleepNano = ACTION_INTERVAL_NS - elapsedNanoSinceLastAction;
-    if (sleepNano > 0) {
-      better_sleep(0, sleepNano);
+    SimEvent event;
+    if (popEvent(&events, &event) == -1) {
+      continue;
+    }
+
+    if (event.type == EVENT_WORKER_WAKE &&
+        (processTable[event.index].pid != event.pid ||
+         processTable[event.index].state != PROCESS_RUNNING ||
+         atomic_load(&processTable[event.index].blocked) != WORKER_SCHEDULED ||
+         wakeTime(&processTable[event.index]) != event.time)) {
+      continue; // Worker exited, was already woken or has parked again
+    }
+
+    unsigned long now = clockNanoseconds(simClock);
+    if (event.time > now) {
+      wakeDueWorkers(event.time);
+      writeClock(simClock, event.time / ONE_SECOND, event.time % ONE_SECOND);
+      now = event.time;
+    } else if (event.type == EVENT_WORKER_WAKE) {
+      atomic_store(&processTable[event.index].blocked, WORKER_BUSY);
+    }
+
+    switch (event.type) {
+    case EVENT_LAUNCH:
+      if (currentChildren < maxSimultaneous && stillChildrenToLaunch()) {
+        launchChild();
+      }
+      if (totalLaunched < maxProcesses) {
+        event.time = now + launchGap;
+        pushEvent(&events, event);
+      }
+      break;
+    case EVENT_TABLE_DUMP:
+      logResourceTableChanges();
+      logProcessTable();
+      event.time = now + HALF_SECOND;
+      pushEvent(&events, event);
+      break;
+    case EVENT_DEADLOCK_CHECK:
+      if (unsafeSystem()) {
+        resolveDeadlocks();
+        grantWaitingRequests();
+      }
+      displaySharedMemoryTimes();
+      event.time = now + ONE_SECOND;
+      pushEvent(&events, event);
+      break;
+    case EVENT_WORKER_WAKE:
+      break; // The worker resumes on its own once it sees the new time
     }
   }
 
-  // Log final statistics before exiting
+  freeEventQueue(&events);
   logStatistics();
 }
 
-void manageResourceRequests(void) {
-  MessageA5 msg;
-  int result;
-
-  // Non-blocking check for messages
-  while (true) {
-    result = receiveMessage(msqId, &msg, sizeof(msg), IPC_NOWAIT);
-
-    if (result ==
-        0) { // Check for success (receiveMessage returns '0' for success)
-      log_message(
-          LOG_LEVEL_DEBUG, 0,
-          "Received message from PID %d: Command %d, ResourceType %d, Count %d",
-          msg.senderPid, msg.commandType, msg.resourceType, msg.count);
-
-      // Handle resource request or release based on the command type
-      if (msg.commandType == MSG_REQUEST_RESOURCE) {
-        if (requestResource(msg.senderPid, msg.resourceType, msg.count) == 0) {
-          log_message(LOG_LEVEL_INFO, 0, "Resource allocated to PID %d",
-                      msg.senderPid);
-        } else {
-          log_message(LOG_LEVEL_WARN, 0,
-                      "Failed to allocate resource to PID %d", msg.senderPid);
-          enqueue(&resourceQueues[msg.resourceType], msg); // Add to wait queue
-        }
-      } else if (msg.commandType == MSG_RELEASE_RESOURCE) {
-        if (releaseResource(msg.senderPid, msg.resourceType, msg.count) == 0) {
-          log_message(LOG_LEVEL_INFO, 0, "Resource released by PID %d",
-                      msg.senderPid);
-        } else {
-          log_message(LOG_LEVEL_DEBUG, 0,
-                      "Failed to release resource by PID %d", msg.senderPid);
-        }
+void launchChild(void) {
+  if (workerRuntime == RUNTIME_THREAD) {
+    // Registered first, so the task finds its slot when it starts
+    pid_t id = nextTaskId();
+    if (id == -1)
+      return;
+    registerChildProcess(id);
+    if (startWorkerTask(id) != 0) {
+      clearProcessEntry(findProcessIndexByPID(id));
+      return;
+    }
+    traceEvent(TRACE_LAUNCH, id, findProcessIndexByPID(id), -1, 0);
+    totalLaunched++;
+    currentChildren++;
+    return;
+  }
+
+  if (pooledWorkers > 0) {
+    int index = workerPool[--pooledWorkers];
+    activatePooledProcess(index);
+    traceEvent(TRACE_LAUNCH, processTable[index].pid, index, -1, 0);
+    totalLaunched++;
+    currentChildren++;
+    return; // The main loop spawns its replacement, see refillWorkerPool()
+  }
+
+  pid_t pid = spawnWorker(WORKER_EXECUTABLE, false);
+  if (pid > 0) {
+    registerChildProcess(pid);
+    traceEvent(TRACE_LAUNCH, pid, findProcessIndexByPID(pid), -1, 0);
+    totalLaunched++;
+    currentChildren++;
+  }
+}
+
+// Tops the pool up to -p parked workers before the simulation starts
+void fillWorkerPool(void) {
+  while (refillWorkerPool()) {
+  }
+}
+
+// Spawns one pool worker if the pool is short, but never more workers than
+// are still to be launched. The main loops call this once per pass, so a
+// launch never waits on a fork and replacements are spread out. Returns
+// true if a worker was added.
+bool refillWorkerPool(void) {
+  if (workerRuntime != RUNTIME_PROCESS || pooledWorkers >= poolSize ||
+      totalLaunched + pooledWorkers >= maxProcesses)
+    return false;
+  pid_t pid = spawnWorker(WORKER_EXECUTABLE, true);
+  if (pid <= 0)
+    return false;
+  int index = registerPooledProcess(pid);
+  if (index == -1)
+    return false;
+  workerPool[pooledWorkers++] = index;
+  return true;
+}
+
+// Sends away pool workers that were never launched
+void drainWorkerPool(void) {
+  while (pooledWorkers > 0) {
+    int index = workerPool[--pooledWorkers];
+    kill(processTable[index].pid, SIGTERM);
+    clearProcessEntry(index);
+  }
+}
+
+unsigned long wakeTime(const PCB *pcb) {
+  return (unsigned long)pcb->eventBlockedUntilSec * ONE_SECOND +
+         pcb->eventBlockedUntilNano;
+}
+
+// Turns newly parked workers into wake-up events
+void scheduleParkedWorkers(EventQueue *events) {
+  for (int i = 0; i < processSlots; i++) {
+    PCB *pcb = &processTable[i];
+    if (!pcb->occupied || pcb->state != PROCESS_RUNNING ||
+        atomic_load(&pcb->blocked) != WORKER_PARKED) {
+      continue;
+    }
+    SimEvent event = {.time = wakeTime(pcb),
+                      .type = EVENT_WORKER_WAKE,
+                      .index = i,
+                      .pid = pcb->pid};
+    atomic_store(&pcb->blocked, WORKER_SCHEDULED);
+    pushEvent(events, event);
+  }
+}
+
+// Marks every worker due by `time` busy before the clock reaches it, so none
+// of them is mistaken for parked while it acts
+void wakeDueWorkers(unsigned long time) {
+  for (int i = 0; i < processSlots; i++) {
+    PCB *pcb = &processTable[i];
+    if (pcb->occupied && pcb->state == PROCESS_RUNNING &&
+        atomic_load(&pcb->blocked) == WORKER_SCHEDULED &&
+        wakeTime(pcb) <= time) {
+      atomic_store(&pcb->blocked, WORKER_BUSY);
+    }
+  }
+}
+
+// Handles at most MESSAGE_BUDGET inbound messages, so a flood cannot hold
+// the clock still. Returns true if the budget ran out and more may be waiting.
+bool manageResourceRequests(void) {
+  MessageA5 batch[MESSAGE_BUDGET];
+  int count = receiveBatch(batch, MESSAGE_BUDGET);
+  if (count > 0) {
+    handleResourceBatch(batch, count);
+  }
+  return count == MESSAGE_BUDGET;
+}
+
+int receiveBatch(MessageA5 *batch, int maxMessages) {
+  if (workerRuntime == RUNTIME_THREAD) {
+    return drainTaskChannel(batch, maxMessages);
+  }
+  if (transportType == TRANSPORT_RING) {
+    return drainRings(batch, maxMessages);
+  }
+
+  int count = 0;
+  while (count < maxMessages) {
+    if (receiveMessage(msqId, MSG_TYPE_MASTER, &batch[count], IPC_NOWAIT) ==
+        0) {
+      count++;
+    } else {
+      if (errno != ENOMSG) {
+        log_message(LOG_LEVEL_ERROR, 0, "Failed to receive messages: %s",
+                    strerror(errno));
       }
-    } else if (result == -1 && errno != ENOMSG) {
-      // Handle unexpected errors
-      log_message(LOG_LEVEL_ERROR, 0, "Failed to receive messages: %s",
-                  strerror(errno));
       break;
+    }
+  }
+  return count;
+}
+
+// Each worker has at most one request or release in flight, so a batch can
+// be reordered freely. It is counting-sorted into releases then requests,
+// each grouped by resource class, and applied in two passes under the table
+// lock, with queued waiters served in between so they keep their claim on
+// freed instances ahead of newcomers. Replies follow in one pass.
+void handleResourceBatch(const MessageA5 *batch, int count) {
+  const MessageA5 *sorted[MESSAGE_BUDGET];
+  int results[MESSAGE_BUDGET];
+  int keys[MESSAGE_BUDGET];
+  int start[2 * MAX_RESOURCES + 1] = {0};
+
+  for (int i = 0; i < count; i++) {
+    const MessageA5 *msg = &batch[i];
+    int group = groupOf(msg);
+    keys[i] = -1;
+    if (msg->commandType == REGISTER_CLAIM) {
+      // Declared before the worker's first request, so handled on arrival
+      registerClaim(msg);
+    } else if (group == -2) {
+      continue;
+    } else if (group == -1) {
+      log_message(LOG_LEVEL_WARN, 0, "PID %ld sent unknown resource %d",
+                  msg->senderPid, msg->resourceType);
+      traceEvent(TRACE_DENY, msg->senderPid,
+                 findProcessIndexByPID(msg->senderPid), msg->resourceType,
+                 msg->count);
+      sendReply(msg, 0, REPLY_DENIED);
     } else {
-      break;
+      bool request = msg->commandType == REQUEST_RESOURCE ||
+                     msg->commandType == REQUEST_VECTOR;
+      keys[i] = group + (request ? maxResources : 0);
+      start[keys[i] + 1]++;
     }
   }
+
+  for (int k = 1; k <= 2 * maxResources; k++) {
+    start[k] += start[k - 1];
+  }
+  int releases = start[maxResources];
+  int applied = start[2 * maxResources];
+  for (int i = 0; i < count; i++) {
+    if (keys[i] != -1)
+      sorted[start[keys[i]]++] = &batch[i];
+  }
+
+  applyResourceBatch(sorted, releases, results);
+  grantWaitingRequests();
+  applyResourceBatch(sorted + releases, applied - releases, results + releases);
+
+  for (int i = 0; i < applied; i++) {
+    answerResourceMessage(sorted[i], results[i]);
+  }
+  grantWaitingRequests();
+
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Handled %d messages: %d releases, %d requests", count, releases,
+              applied - releases);
+}
+
+// Resource class a request or release is grouped under in a batch: its
+// own, or a vector's first. -1 if a single-class message names an unknown
+// class, -2 if the command is not a request or release. Vectors are checked
+// in full when applied.
+int groupOf(const MessageA5 *msg) {
+  switch (msg->commandType) {
+  case REQUEST_RESOURCE:
+  case RELEASE_RESOURCE:
+    return msg->resourceType >= 0 && msg->resourceType < maxResources
+               ? msg->resourceType
+               : -1;
+  case REQUEST_VECTOR:
+  case RELEASE_VECTOR:
+    if (msg->vectorLength > 0 && msg->vectorLength <= VECTOR_MAX_ENTRIES &&
+        msg->vector[0].resourceType >= 0 &&
+        msg->vector[0].resourceType < maxResources)
+      return msg->vector[0].resourceType;
+    return 0;
+  case RELEASE_ALL:
+    return 0;
+  default:
+    return -2;
+  }
+}
+
+void answerResourceMessage(const MessageA5 *msg, int result) {
+  int index = findProcessIndexByPID(msg->senderPid);
+  if (index != -1 && processTable[index].state != PROCESS_RUNNING) {
+    return; // Killed earlier in this pass; its KILLED reply is the answer
+  }
+
+  if (msg->commandType == RELEASE_RESOURCE ||
+      msg->commandType == RELEASE_VECTOR || msg->commandType == RELEASE_ALL) {
+    if (result >= 0) {
+      sendReply(msg, msg->commandType == RELEASE_ALL ? result : msg->count,
+                REPLY_GRANTED);
+    } else {
+      log_message(LOG_LEVEL_DEBUG, 0, "Failed to release resource by PID %ld",
+                  msg->senderPid);
+      traceEvent(TRACE_DENY, msg->senderPid, index, msg->resourceType,
+                 msg->count);
+      sendReply(msg, 0, REPLY_DENIED);
+    }
+    return;
+  }
+
+  if (result == REQUEST_GRANTED) {
+    sendReply(msg, msg->count, REPLY_GRANTED);
+  } else if (result == REQUEST_WAIT && enqueueWaiter(index, msg)) {
+    // The worker stays blocked until the grant scheduler can meet the request
+    sendReply(msg, 0, REPLY_QUEUED);
+    if (discreteEvents)
+      atomic_store(&processTable[index].blocked, WORKER_WAITING);
+    resolveDeadlockFrom(index);
+  } else {
+    log_message(LOG_LEVEL_WARN, 0, "Failed to allocate resource to PID %ld",
+                msg->senderPid);
+    traceEvent(TRACE_DENY, msg->senderPid, index, msg->resourceType,
+               msg->count);
+    sendReply(msg, 0, REPLY_DENIED);
+  }
 }
 
+// Queues a request that has to wait on the class it is waiting for, which
+// for a vector is the first one still short. Returns false if that queue is
+// full.
+bool enqueueWaiter(int index, const MessageA5 *msg) {
+  MessageA5 waiting = *msg;
+  int count = msg->count;
+  if (msg->commandType == REQUEST_VECTOR) {
+    waiting.resourceType = vectorWaitingOn(msg);
+    count = vectorCount(msg, waiting.resourceType);
+  }
+
+  Queue *queue = &resourceQueues[waiting.resourceType];
+  if (queueLength(queue) >= queue->capacity - 1)
+    return false;
+  enqueue(queue, waiting);
+  waitGraphBlock(index, waiting.resourceType, count);
+  traceEvent(TRACE_WAIT, msg->senderPid, index, waiting.resourceType, count);
+  return true;
+}
+
+// Grant scheduler. Only the queues of resource classes given back since the
+// last call are walked. Under avoidance a release of one class can make a
+// deferred request for another safe, so then every waiting queue is.
+void grantWaitingRequests(void) {
+  int resourceType = takeFreedResource();
+  if (resourceType == -1)
+    return;
+
+  if (avoidDeadlocks) {
+    noteFreedResource(resourceType);
+    for (int r = 0; r < maxResources; r++) {
+      if (queueLength(&resourceQueues[r]) > 0)
+        noteFreedResource(r);
+    }
+    resourceType = takeFreedResource();
+  }
+
+  for (; resourceType != -1; resourceType = takeFreedResource()) {
+    grantFromQueue(&resourceQueues[resourceType], resourceType);
+  }
+}
+
+void grantFromQueue(Queue *q, int resourceType) {
+  // Grant in arrival order. A waiter that cannot be met yet, because it
+  // asks for more instances than are free or under avoidance is unsafe only
+  // for its own process, does not hold back smaller requests behind it:
+  // those may be what has to finish before it can go on.
+  for (int i = 0; i < queueLength(q) && resourceAvailable[resourceType] > 0;) {
+    MessageA5 request = *queueAt(q, i);
+    bool vector = request.commandType == REQUEST_VECTOR;
+    int result = vector ? grantQueuedVector(&request)
+                        : grantQueuedRequest(request.senderPid, resourceType,
+                                             request.count);
+    if (vector && result == REQUEST_WAIT &&
+        vectorWaitingOn(&request) != resourceType) {
+      // This class can be met now, but another it needs is still short. A
+      // cycle the move closes is left to the periodic check.
+      removeFromQueue(q, i);
+      enqueueWaiter(findProcessIndexByPID(request.senderPid), &request);
+      continue;
+    }
+    if (result != REQUEST_GRANTED) {
+      i++;
+      continue;
+    }
+    removeFromQueue(q, i);
+    log_message(LOG_LEVEL_INFO, 0, "Queued request of PID %ld granted",
+                request.senderPid);
+    wakeWaiter(findProcessIndexByPID(request.senderPid), &request,
+               request.count, REPLY_GRANTED);
+  }
+}
+
+void wakeWaiter(int index, const MessageA5 *request, int count, int status) {
+  waitGraphUnblock(index);
+  if (discreteEvents && index != -1) {
+    // Busy before the reply, so the clock cannot move while it acts on it
+    atomic_store(&processTable[index].blocked, WORKER_BUSY);
+  }
+  sendReply(request, count, status);
+}
+
+void removeQueuedRequest(pid_t pid, int resourceType) {
+  Queue *q = &resourceQueues[resourceType];
+  for (int i = 0; i < queueLength(q); i++) {
+    if (queueAt(q, i)->senderPid == pid) {
+      removeFromQueue(q, i);
+      return;
+    }
+  }
+}
+
+// Called for each deadlock victim once its resources are released. Only a
+// victim blocked on a queued request is sent a KILLED reply, since nothing
+// else would read it. A worker process doing anything else is sent SIGTERM;
+// a worker thread is marked killed and stops at its next check.
+void notifyVictim(int index) {
+  MessageA5 request = {.senderPid = processTable[index].pid,
+                       .commandType = REQUEST_RESOURCE,
+                       .resourceType = -1};
+  int waitingOn = waitGraphWaitingOn(index);
+  if (waitingOn != -1) {
+    removeQueuedRequest(request.senderPid, waitingOn);
+    request.resourceType = waitingOn;
+    wakeWaiter(index, &request, 0, REPLY_KILLED);
+  } else if (workerRuntime == RUNTIME_PROCESS) {
+    kill(request.senderPid, SIGTERM);
+  } else {
+    killWorkerTask(request.senderPid);
+  }
+}
+
+// Replies are addressed by using the worker's PID as the mtype, so each worker
+// only ever dequeues its own answers. Worker threads get theirs in their
+// mailbox instead.
+void sendReply(const MessageA5 *request, int count, int status) {
+  MessageA5 reply = {.senderPid = getpid(),
+                     .commandType = request->commandType,
+                     .resourceType = request->resourceType,
+                     .count = count,
+                     .status = status};
+
+  if (workerRuntime == RUNTIME_THREAD) {
+    deliverToTask(request->senderPid, &reply);
+    return;
+  }
+  if (sendMessage(msqId, request->senderPid, &reply) != 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to send reply to PID %ld",
+                request->senderPid);
+  }
+}
+
+// Checks whether blocking the process in slot index closed a cycle, and if
+// so kills the cheapest process in the deadlock until the rest can go on
+void resolveDeadlockFrom(int index) {
+  const int *deadlocked;
+  int count;
+  while ((count = findDeadlockFrom(index, &deadlocked)) > 0) {
+    log_message(LOG_LEVEL_WARN, 0,
+                "Deadlock among %d processes formed when PID %d blocked.",
+                count, processTable[index].pid);
+    int victim = chooseVictim(deadlocked, count);
+    recordVictim(victim, deadlocked, count);
+    terminateDeadlockedProcess(victim);
+  }
+}
+
+// Reaps exited worker processes and finished worker threads
 void manageChildTerminations(void) {
   int status;
   pid_t pid;
   while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-    releaseAllResourcesForProcess(pid);
-    currentChildren--;
-    successfullyTerminated++;
+    reapChild(pid);
+  }
+  while ((pid = reapWorkerTask()) != -1) {
+    reapChild(pid);
+  }
+  grantWaitingRequests();
+}
+
+void reapChild(pid_t pid) {
+  int index = findProcessIndexByPID(pid);
+  if (index != -1 && processTable[index].state == PROCESS_POOLED) {
+    // Died before it was launched; it never counted as a child
+    for (int i = 0; i < pooledWorkers; i++) {
+      if (workerPool[i] == index)
+        workerPool[i] = workerPool[--pooledWorkers];
+    }
+    clearProcessEntry(index);
+    return;
+  }
+  int waitingOn = waitGraphWaitingOn(index);
+  if (waitingOn != -1) {
+    removeQueuedRequest(pid, waitingOn); // Gone while queued, no reply
+  }
+  releaseAllResourcesForProcess(pid);
+  traceEvent(TRACE_EXIT, pid, index, -1, 0);
+  if (index != -1) {
+    waitGraphUnblock(index);
+    clearProcessEntry(index);
   }
+  currentChildren--;
+  successfullyTerminated++;
 }
 
 bool shouldLaunchNextChild(void) {
   static unsigned long lastLaunchSecond = 0;
-  if (currentChildren < MAX_SIMULTANEOUS &&
-      simClock->seconds > lastLaunchSecond + 1) {
-    lastLaunchSecond = simClock->seconds;
+  unsigned long currentSec, currentNano;
+  readClock(simClock, &currentSec, &currentNano);
+  if (currentChildren < maxSimultaneous &&
+      currentSec > lastLaunchSecond + 1) {
+    lastLaunchSecond = currentSec;
     return true;
   }
   return false;
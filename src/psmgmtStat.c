@@ -0,0 +1,165 @@
+#include "globals.h"
+#include "stats.h"
+
+#include <time.h>
+
+#define HEADER_EVERY 20 // Sample lines between column headers
+
+// psmgmt-stat: samples the statistics a running psmgmt publishes, like vmstat
+static void printStatUsage(const char *programName) {
+  printf("Usage: %s [-h] [-r] [-w] [interval [count]]\n", programName);
+  printf("Options:\n");
+  printf("  -h        Show this help message.\n");
+  printf("  -r        Also print each resource class's use and queue.\n");
+  printf("  -w        Also print the counters of each running worker.\n");
+  printf("  interval  Seconds between samples (default 1).\n");
+  printf("  count     Stop after this many samples (default: until psmgmt "
+         "exits).\n");
+}
+
+// The header counters one line is computed from
+typedef struct {
+  uint64_t exited;
+  uint64_t requests;
+  uint64_t grants;
+  uint64_t queuedGrants;
+  uint64_t deadlockKills;
+} StatSample;
+
+#define LOAD(field) atomic_load_explicit(&field, memory_order_relaxed)
+
+static StatSample takeSample(const StatsHeader *header) {
+  StatSample sample = {
+      .exited = LOAD(header->exited),
+      .requests = LOAD(header->requests),
+      .grants = LOAD(header->immediateGrants) + LOAD(header->queuedGrants),
+      .queuedGrants = LOAD(header->queuedGrants),
+      .deadlockKills = LOAD(header->deadlockKills),
+  };
+  return sample;
+}
+
+static void printHeader(void) {
+  printf("%10s %5s %8s %6s %8s %8s %6s %7s %6s %6s\n", "sim-time", "run",
+         "launched", "exit", "req", "grant", "qgrant", "waiting", "kill",
+         "util%");
+}
+
+// One line: counts since the previous sample, gauges as they stand now
+static void printSample(const StatsHeader *header, const StatSample *now,
+                        const StatSample *last) {
+  const ResourceStats *resources = STATS_RESOURCES(header);
+  long inUse = 0;
+  int waiting = 0;
+  for (int r = 0; r < header->resourceCount; r++) {
+    inUse += LOAD(resources[r].inUse);
+    waiting += LOAD(resources[r].queueDepth);
+  }
+  long capacity = (long)header->resourceCount * header->maxInstances;
+
+  printf("%10.3f %5d %8lu %6lu %8lu %8lu %6lu %7d %6lu %6.1f\n",
+         (double)LOAD(header->simulatedTime) / NANOSECONDS_IN_SECOND,
+         LOAD(header->currentChildren),
+         (unsigned long)LOAD(header->launched),
+         (unsigned long)(now->exited - last->exited),
+         (unsigned long)(now->requests - last->requests),
+         (unsigned long)(now->grants - last->grants),
+         (unsigned long)(now->queuedGrants - last->queuedGrants), waiting,
+         (unsigned long)(now->deadlockKills - last->deadlockKills),
+         capacity > 0 ? 100.0 * inUse / capacity : 0.0);
+}
+
+static void printResources(const StatsHeader *header) {
+  const ResourceStats *resources = STATS_RESOURCES(header);
+  for (int r = 0; r < header->resourceCount; r++) {
+    int inUse = LOAD(resources[r].inUse);
+    printf("  R%-4d used %5d/%-5d %5.1f%%  queue %d\n", r, inUse,
+           header->maxInstances,
+           header->maxInstances > 0 ? 100.0 * inUse / header->maxInstances
+                                    : 0.0,
+           LOAD(resources[r].queueDepth));
+  }
+}
+
+static void printWorkers(const StatsHeader *header) {
+  const WorkerStats *workers = STATS_WORKERS(header);
+  for (int i = 0; i < header->processSlots; i++) {
+    if (!LOAD(workers[i].active))
+      continue;
+    printf("  P%-8d req %-6lu grant %-6lu wait %-6lu deny %-6lu rel %lu\n",
+           LOAD(workers[i].pid), (unsigned long)LOAD(workers[i].requests),
+           (unsigned long)LOAD(workers[i].grants),
+           (unsigned long)LOAD(workers[i].waits),
+           (unsigned long)LOAD(workers[i].denials),
+           (unsigned long)LOAD(workers[i].releases));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool showResources = false;
+  bool showWorkers = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "hrw")) != -1) {
+    switch (opt) {
+    case 'r':
+      showResources = true;
+      break;
+    case 'w':
+      showWorkers = true;
+      break;
+    case 'h':
+      printStatUsage(argv[0]);
+      return EXIT_SUCCESS;
+    default:
+      printStatUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  double interval = 1.0;
+  long count = 0;
+  if (optind < argc)
+    interval = atof(argv[optind++]);
+  if (optind < argc)
+    count = atol(argv[optind++]);
+  if (optind < argc || interval <= 0 || count < 0) {
+    printStatUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (attachStats(true) != SUCCESS) {
+    fprintf(stderr, "No psmgmt statistics to read: %s\n",
+            errno == EPROTO ? "written by a different version"
+                            : "is psmgmt running?");
+    return EXIT_FAILURE;
+  }
+
+  // The first line covers the run so far, like vmstat's
+  StatSample last = {0};
+  struct timespec pause = {(time_t)interval,
+                           (long)((interval - (time_t)interval) *
+                                  NANOSECONDS_IN_SECOND)};
+  for (long n = 0; count == 0 || n < count; n++) {
+    if (n > 0)
+      nanosleep(&pause, NULL);
+
+    // Stop after the final snapshot, or if psmgmt died without one
+    bool done = !LOAD(statsHeader->running) ||
+                (kill(statsHeader->psmgmtPid, 0) == -1 && errno == ESRCH);
+    StatSample now = takeSample(statsHeader);
+    if (n % HEADER_EVERY == 0)
+      printHeader();
+    printSample(statsHeader, &now, &last);
+    if (showResources)
+      printResources(statsHeader);
+    if (showWorkers)
+      printWorkers(statsHeader);
+    fflush(stdout);
+    last = now;
+    if (done)
+      break;
+  }
+
+  shmdt(statsHeader);
+  return EXIT_SUCCESS;
+}
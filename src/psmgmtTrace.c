@@ -0,0 +1,61 @@
+#include "globals.h"
+#include "trace.h"
+
+// psmgmt-trace: renders a trace written with psmgmt -e
+static void printTraceUsage(const char *programName) {
+  printf("Usage: %s [-h] [-f text|csv|spec] trace_file\n", programName);
+  printf("Options:\n");
+  printf("  -h        Show this help message.\n");
+  printf("  -f format Output format: text (psmgmt's log lines, default), csv "
+         "or spec (processes named by process table slot).\n");
+}
+
+int main(int argc, char *argv[]) {
+  TraceFormat format = TRACE_FORMAT_TEXT;
+  int opt;
+  while ((opt = getopt(argc, argv, "hf:")) != -1) {
+    switch (opt) {
+    case 'f':
+      if (strcmp(optarg, "text") == 0) {
+        format = TRACE_FORMAT_TEXT;
+      } else if (strcmp(optarg, "csv") == 0) {
+        format = TRACE_FORMAT_CSV;
+      } else if (strcmp(optarg, "spec") == 0) {
+        format = TRACE_FORMAT_SPEC;
+      } else {
+        fprintf(stderr, "Invalid format specified: %s\n", optarg);
+        return EXIT_FAILURE;
+      }
+      break;
+    case 'h':
+      printTraceUsage(argv[0]);
+      return EXIT_SUCCESS;
+    default:
+      printTraceUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+  if (optind != argc - 1) {
+    printTraceUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  TraceView view;
+  if (loadTrace(argv[optind], &view) != 0) {
+    fprintf(stderr, "Cannot read trace %s: %s\n", argv[optind],
+            strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  if (format == TRACE_FORMAT_CSV) {
+    printf("time,event,pid,index,resource,count,available\n");
+  }
+  char line[LOG_BUFFER_SIZE];
+  for (uint64_t i = 0; i < view.count; i++) {
+    formatTraceRecord(&view.records[i], format, line, sizeof(line));
+    puts(line);
+  }
+
+  unloadTrace(&view);
+  return EXIT_SUCCESS;
+}
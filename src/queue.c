@@ -63,3 +63,30 @@ int dequeue(Queue *q, MessageA5 *item) {
               item->senderPid);
   return 0;
 }
+
+int queueLength(const Queue *q) {
+  if (q->capacity == 0)
+    return 0;
+  return (q->rear - q->front + q->capacity) % q->capacity;
+}
+
+// Entry at position, counting from the front, or NULL past the end
+const MessageA5 *queueAt(const Queue *q, int position) {
+  if (position < 0 || position >= queueLength(q))
+    return NULL;
+  return &q->queue[(q->front + position) % q->capacity];
+}
+
+// Drops the entry at position, keeping the rest in arrival order
+int removeFromQueue(Queue *q, int position) {
+  int length = queueLength(q);
+  if (position < 0 || position >= length)
+    return -1;
+
+  for (int i = position; i < length - 1; i++) {
+    q->queue[(q->front + i) % q->capacity] =
+        q->queue[(q->front + i + 1) % q->capacity];
+  }
+  q->rear = (q->rear - 1 + q->capacity) % q->capacity;
+  return 0;
+}
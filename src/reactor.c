@@ -0,0 +1,139 @@
+#include "reactor.h"
+#include "ring.h"
+
+static int epollFd = -1;
+static int timerFd = -1;
+static int signalFd = -1;
+static int wakeupFd = -1; // Shared with workers through WAKEUP_FD_ENV
+
+static int watchFd(int fd, unsigned int source) {
+  struct epoll_event event = {.events = EPOLLIN, .data.u32 = source};
+  return epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+}
+
+int initializeReactor(bool clockTick) {
+  // SIGCHLD is consumed through the signalfd instead of a handler
+  sigset_t mask;
+  sigemptyset(&mask);
+  sigaddset(&mask, SIGCHLD);
+  if (sigprocmask(SIG_BLOCK, &mask, NULL) == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to block SIGCHLD: %s",
+                strerror(errno));
+    return -1;
+  }
+
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  signalFd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+  timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  wakeupFd = eventfd(0, EFD_NONBLOCK); // Inherited across exec on purpose
+  if (epollFd == -1 || signalFd == -1 || timerFd == -1 || wakeupFd == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to create reactor descriptors: %s",
+                strerror(errno));
+    closeReactor();
+    return -1;
+  }
+
+  // Discrete-event runs advance the clock themselves and leave it disarmed
+  struct itimerspec tick = {.it_interval = {0, REACTOR_TICK_NS},
+                            .it_value = {0, clockTick ? REACTOR_TICK_NS : 0}};
+  if (timerfd_settime(timerFd, 0, &tick, NULL) == -1 ||
+      watchFd(timerFd, REACTOR_TICK) == -1 ||
+      watchFd(signalFd, REACTOR_CHILD) == -1 ||
+      watchFd(wakeupFd, REACTOR_WAKEUP) == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to arm reactor: %s",
+                strerror(errno));
+    closeReactor();
+    return -1;
+  }
+
+  char fdString[16];
+  snprintf(fdString, sizeof(fdString), "%d", wakeupFd);
+  setenv(WAKEUP_FD_ENV, fdString, 1);
+
+  log_message(LOG_LEVEL_DEBUG, 0, "Reactor initialized (wakeup fd %d).",
+              wakeupFd);
+  return SUCCESS;
+}
+
+unsigned int waitForEvents(int timeoutMs, unsigned long *ticks) {
+  struct epoll_event events[REACTOR_MAX_EVENTS];
+  unsigned int ready = 0;
+  int timeout = timeoutMs;
+  *ticks = 0;
+
+  // Workers on the ring transport only kick the eventfd while we sleep
+  if (ringTransport != NULL) {
+    atomic_store(&ringTransport->masterSleeping, 1);
+    if (ringsPending()) {
+      timeout = 0;
+    }
+  }
+
+  int count = epoll_wait(epollFd, events, REACTOR_MAX_EVENTS, timeout);
+
+  if (ringTransport != NULL) {
+    atomic_store(&ringTransport->masterSleeping, 0);
+  }
+
+  if (count == -1) {
+    if (errno != EINTR) {
+      log_message(LOG_LEVEL_ERROR, 0, "epoll_wait failed: %s",
+                  strerror(errno));
+    }
+    return ready;
+  }
+
+  for (int i = 0; i < count; i++) {
+    uint64_t value;
+    ready |= events[i].data.u32;
+    switch (events[i].data.u32) {
+    case REACTOR_TICK:
+      if (read(timerFd, &value, sizeof(value)) == sizeof(value)) {
+        *ticks = value;
+      }
+      break;
+    case REACTOR_CHILD: {
+      struct signalfd_siginfo info;
+      while (read(signalFd, &info, sizeof(info)) == sizeof(info)) {
+      }
+      break;
+    }
+    case REACTOR_WAKEUP:
+      if (read(wakeupFd, &value, sizeof(value)) != sizeof(value)) {
+        log_message(LOG_LEVEL_DEBUG, 0, "Spurious wakeup on eventfd.");
+      }
+      break;
+    }
+  }
+  return ready;
+}
+
+void closeReactor(void) {
+  int *fds[] = {&epollFd, &timerFd, &signalFd, &wakeupFd};
+  for (size_t i = 0; i < sizeof(fds) / sizeof(fds[0]); i++) {
+    if (*fds[i] != -1) {
+      close(*fds[i]);
+      *fds[i] = -1;
+    }
+  }
+}
+
+void notifyMaster(void) {
+  static int fd = -2; // -2 until the environment has been consulted
+  if (fd == -2) {
+    const char *value = getenv(WAKEUP_FD_ENV);
+    fd = value ? atoi(value) : -1;
+    if (fd >= 0 && fcntl(fd, F_GETFD) == -1) {
+      fd = -1; // Not inherited, psmgmt falls back to its clock tick
+    }
+  }
+  if (fd < 0) {
+    return;
+  }
+
+  uint64_t one = 1;
+  if (write(fd, &one, sizeof(one)) == -1 && errno != EAGAIN) {
+    log_message(LOG_LEVEL_DEBUG, 0, "Failed to wake psmgmt: %s",
+                strerror(errno));
+  }
+}
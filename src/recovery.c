@@ -0,0 +1,67 @@
+#include "recovery.h"
+#include "resource.h"
+#include "simclock.h"
+#include "waitgraph.h"
+
+// Weight of one earlier victim, in held instances. Killing a process that
+// others already died for wastes their sacrifice as well as its own work.
+#define PRIOR_KILL_COST 10.0
+
+VictimCostFunction victimCost = defaultVictimCost;
+
+// Held instances and simulated seconds in the system are both work that a
+// kill throws away, so they count one for one
+double defaultVictimCost(const VictimCandidate *candidate) {
+  return candidate->resourcesHeld +
+         (double)(candidate->age + candidate->waited) / ONE_SECOND +
+         candidate->priorKills * PRIOR_KILL_COST;
+}
+
+static void describeCandidate(int index, unsigned long now,
+                              VictimCandidate *candidate) {
+  const PCB *pcb = &processTable[index];
+  unsigned long start =
+      (unsigned long)pcb->startSeconds * ONE_SECOND + pcb->startNano;
+
+  candidate->index = index;
+  candidate->resourcesHeld = 0;
+  const int *row = &ALLOCATED(index, 0);
+  for (int r = 0; r < maxResources; r++) {
+    candidate->resourcesHeld += row[r];
+  }
+  candidate->age = now > start ? now - start : 0;
+  candidate->waited = waitGraphWaitTime(index, now);
+  candidate->priorKills = pcb->victimsTaken;
+}
+
+// Returns the slot among candidates that is cheapest to kill
+int chooseVictim(const int *candidates, int count) {
+  unsigned long now = clockNanoseconds(simClock);
+  int victim = -1;
+  double lowest = 0;
+
+  for (int i = 0; i < count; i++) {
+    VictimCandidate candidate;
+    describeCandidate(candidates[i], now, &candidate);
+    double cost = victimCost(&candidate);
+    if (victim == -1 || cost < lowest) {
+      victim = candidates[i];
+      lowest = cost;
+    }
+  }
+
+  if (victim != -1) {
+    log_message(LOG_LEVEL_DEBUG, 0,
+                "Chose PID %d as deadlock victim at cost %.2f out of %d.",
+                processTable[victim].pid, lowest, count);
+  }
+  return victim;
+}
+
+// Credits every other candidate with the kill made on its behalf
+void recordVictim(int victim, const int *candidates, int count) {
+  for (int i = 0; i < count; i++) {
+    if (candidates[i] != victim)
+      processTable[candidates[i]].victimsTaken++;
+  }
+}
@@ -1,10 +1,20 @@
 #include "resource.h"
+#include "detect.h"
 #include "process.h"
+#include "recovery.h"
+#include "simclock.h"
+#include "stats.h"
+#include "trace.h"
+#include "waitgraph.h"
 
 pthread_mutex_t resourceTableMutex =
     PTHREAD_MUTEX_INITIALIZER; // Mutex for resource table
 
-ResourceDescriptor *resourceTable = NULL;
+int *resourceTotal = NULL;
+int *resourceAvailable = NULL;
+int *allocationMatrix = NULL;
+int *claimMatrix = NULL;
+int allocationStride = 0;
 
 int totalRequests = 0;
 int immediateGrantedRequests = 0;
@@ -12,6 +22,34 @@ int waitingGrantedRequests = 0;
 int terminatedByDeadlock = 0;
 int successfullyTerminated = 0;
 int deadlockDetectionRuns = 0;
+int unsafeDeniedRequests = 0;
+
+// psmgmt hooks this to tell the victim's worker, which may be blocked on a
+// queued request
+void (*onDeadlockVictim)(int index) = NULL;
+
+// Banker's state kept between safety checks. NEED() rows are only kept
+// current for processes in holdingRows.
+#define NEED(index, resourceType)                                              \
+  needMatrix[(size_t)(index) * allocationStride + (resourceType)]
+static int *needMatrix = NULL;      // Claim less allocation, like ALLOCATED()
+static int *holdingRows = NULL;     // Slots holding anything, in no order
+static int *holdingPosition = NULL; // Each slot's place there, or -1
+static int *classesHeld = NULL;     // Classes each slot holds any of
+static int holdingCount = 0;
+static int *pendingRows = NULL; // Scratch for stateIsSafe()
+static int *safetyWork = NULL;
+static int safetySlots = 0;
+static int safetyResources = 0;
+
+// Resource classes given back since the grant scheduler last looked
+static int freedResources[MAX_RESOURCES];
+static bool freedMarked[MAX_RESOURCES];
+static int freedCount = 0;
+
+// Slots whose allocations changed since the last table dump, one bit each.
+// NULL until the first dump, which prints every row anyway.
+static uint64_t *dirtyRows = NULL;
 
 bool isProcessRunning(pid_t pid) {
   pthread_mutex_lock(&processTableMutex);
@@ -28,13 +66,170 @@ bool isProcessRunning(pid_t pid) {
   return running;
 }
 
+// Flags resourceType so waiters queued on it are reconsidered
+void noteFreedResource(int resourceType) {
+  if (resourceType < 0 || resourceType >= maxResources ||
+      freedMarked[resourceType])
+    return;
+  freedMarked[resourceType] = true;
+  freedResources[freedCount++] = resourceType;
+}
+
+// Returns the next flagged resource class, or -1 once there are none
+int takeFreedResource(void) {
+  if (freedCount == 0)
+    return -1;
+  int resourceType = freedResources[--freedCount];
+  freedMarked[resourceType] = false;
+  return resourceType;
+}
+
+// Instances process index may still ask for. Without -a nothing is
+// declared, so every process is assumed to want all of every class.
+static inline int remainingNeed(int index, int resourceType) {
+  int claim = avoidDeadlocks ? CLAIMED(index, resourceType)
+                             : resourceTotal[resourceType];
+  return claim - ALLOCATED(index, resourceType);
+}
+
+// Prepares the safety state from the tables. Returns false if out of memory.
+static bool prepareSafetyState(void) {
+  if (needMatrix != NULL && safetySlots == processSlots &&
+      safetyResources == maxResources)
+    return true;
+
+  freeSafetyState();
+  needMatrix = malloc((size_t)processSlots * allocationStride * sizeof(int));
+  holdingRows = malloc(processSlots * sizeof(int));
+  holdingPosition = malloc(processSlots * sizeof(int));
+  classesHeld = calloc(processSlots, sizeof(int));
+  pendingRows = malloc(processSlots * sizeof(int));
+  safetyWork = aligned_alloc(64, allocationStride * sizeof(int));
+  if (needMatrix == NULL || holdingRows == NULL || holdingPosition == NULL ||
+      classesHeld == NULL || pendingRows == NULL || safetyWork == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate safety check state.");
+    freeSafetyState();
+    return false;
+  }
+  safetySlots = processSlots;
+  safetyResources = maxResources;
+
+  for (int i = 0; i < processSlots; i++) {
+    holdingPosition[i] = -1;
+    for (int j = 0; j < maxResources; j++) {
+      if (ALLOCATED(i, j) > 0)
+        classesHeld[i]++;
+    }
+    if (classesHeld[i] > 0) {
+      holdingPosition[i] = holdingCount;
+      holdingRows[holdingCount++] = i;
+    }
+    for (int j = 0; j < maxResources; j++) {
+      NEED(i, j) = remainingNeed(i, j);
+    }
+  }
+  return true;
+}
+
+void freeSafetyState(void) {
+  free(needMatrix);
+  free(holdingRows);
+  free(holdingPosition);
+  free(classesHeld);
+  free(pendingRows);
+  free(safetyWork);
+  needMatrix = NULL;
+  holdingRows = NULL;
+  holdingPosition = NULL;
+  classesHeld = NULL;
+  pendingRows = NULL;
+  safetyWork = NULL;
+  holdingCount = safetySlots = safetyResources = 0;
+}
+
+// Called by setAllocation() once ALLOCATED() holds the new count. A process
+// cannot declare claims while it holds anything, so its need row is rebuilt
+// when it starts holding and only moves with its allocations after that.
+static void trackHolding(int index, int resourceType, int previous,
+                         int count) {
+  if (needMatrix == NULL)
+    return; // Built from the tables at the first safety check
+
+  if (previous == 0 && count > 0 && classesHeld[index]++ == 0) {
+    holdingPosition[index] = holdingCount;
+    holdingRows[holdingCount++] = index;
+    for (int j = 0; j < maxResources; j++) {
+      NEED(index, j) = remainingNeed(index, j);
+    }
+    return;
+  }
+
+  NEED(index, resourceType) -= count - previous;
+  if (previous > 0 && count == 0 && --classesHeld[index] == 0) {
+    int last = holdingRows[--holdingCount];
+    holdingRows[holdingPosition[index]] = last;
+    holdingPosition[last] = holdingPosition[index];
+    holdingPosition[index] = -1;
+  }
+}
+
+// Banker's safety algorithm over the processes holding anything: one that
+// holds nothing gives nothing back when it finishes, and can always finish
+// once everyone else has. With requester set to a slot that was just
+// granted a request out of a safe state, the state is still safe exactly
+// when that process can eventually finish: once it does, work covers
+// everything the old safe sequence had. So the check stops as soon as the
+// requester finishes. Pass -1 to check every process.
+static bool stateIsSafe(int requester) {
+  if (!prepareSafetyState())
+    return false;
+
+  const DetectionKernel *kernel = detectionKernel();
+  memcpy(safetyWork, resourceAvailable, allocationStride * sizeof(int));
+  int unfinished = 0;
+  for (int k = 0; k < holdingCount; k++) {
+    int i = holdingRows[k];
+    if (processTable[i].occupied && processTable[i].state == PROCESS_RUNNING)
+      pendingRows[unfinished++] = i;
+  }
+
+  bool progress = true;
+  while (progress && unfinished > 0) {
+    progress = false;
+    for (int k = 0; k < unfinished; k++) {
+      int i = pendingRows[k];
+      const int *need = &NEED(i, 0);
+      int j = 0;
+      while (j < maxResources && need[j] <= safetyWork[j])
+        j++;
+      if (j < maxResources)
+        continue; // Some class would run short
+
+      kernel->rowAccumulate(safetyWork, &ALLOCATED(i, 0), allocationStride);
+      if (i == requester)
+        return true; // Everyone else can follow the old safe sequence
+      pendingRows[k--] = pendingRows[--unfinished];
+      progress = true;
+    }
+  }
+  return unfinished == 0;
+}
+
+// Keeps the wait-for graph and the safety state in step with the allocation
+// matrix
+void setAllocation(int index, int resourceType, int count) {
+  int previous = ALLOCATED(index, resourceType);
+  ALLOCATED(index, resourceType) = count;
+  waitGraphHoldingChanged(index, resourceType, count > 0);
+  trackHolding(index, resourceType, previous, count);
+  if (dirtyRows != NULL)
+    dirtyRows[index / 64] |= 1ULL << (index % 64);
+}
+
 void log_resource_state(const char *operation, pid_t pid, int resourceType,
                         int count, int availableBefore, int availableAfter) {
   unsigned long currentSec, currentNano;
-  better_sem_wait(clockSem);
-  currentSec = simClock->seconds;
-  currentNano = simClock->nanoseconds;
-  better_sem_post(clockSem);
+  readClock(simClock, &currentSec, &currentNano);
 
   log_message(LOG_LEVEL_INFO, 1,
               "Master %s Process P%d %s R%d %d units at time %lu:%09lu: "
@@ -46,295 +241,682 @@ void log_resource_state(const char *operation, pid_t pid, int resourceType,
               availableAfter);
 }
 
-int requestResource(pid_t pid, int resourceType, int count) {
-  log_message(LOG_LEVEL_DEBUG, 0,
-              "Attempting to request %d units of resource %d for PID %d", count,
-              resourceType, pid);
-
-  pthread_mutex_lock(&resourceTableMutex);
-
+// Shared by first attempts and by grants to queued waiters; queued says
+// which, so each request is counted once and lands in the right statistic.
+// The caller holds resourceTableMutex.
+static int allocateLocked(pid_t pid, int resourceType, int count,
+                          bool queued) {
   // Find the correct index in the process table for the given PID
   int index = findProcessIndexByPID(pid);
   if (index == -1) {
-    pthread_mutex_unlock(&resourceTableMutex);
     log_message(LOG_LEVEL_ERROR, 0,
                 "Invalid PID: %d. Cannot request resources.", pid);
-    return -1; // Invalid PID
+    return REQUEST_DENIED; // Invalid PID
   }
 
-  if (!isProcessRunning(pid)) {
-    pthread_mutex_unlock(&resourceTableMutex);
+  if (processTable[index].state != PROCESS_RUNNING) {
     log_message(LOG_LEVEL_ERROR, 0,
                 "Non-running PID: %d. Cannot request resources.", pid);
-    return -1; // Process is not running
+    return REQUEST_DENIED; // Process is not running
   }
 
-  totalRequests++;
+  if (!queued) {
+    totalRequests++;
+    traceEvent(TRACE_REQUEST, pid, index, resourceType, count);
+  }
 
-  if (resourceTable[resourceType].available < count) {
-    pthread_mutex_unlock(&resourceTableMutex);
+  if (avoidDeadlocks &&
+      ALLOCATED(index, resourceType) + count > CLAIMED(index, resourceType)) {
+    log_message(LOG_LEVEL_WARN, 0,
+                "PID %d asked for %d of R%d beyond its claim of %d.", pid,
+                count, resourceType, CLAIMED(index, resourceType));
+    return REQUEST_DENIED; // Banker's never grants past a declared claim
+  }
+
+  if (resourceAvailable[resourceType] < count) {
     log_message(
         LOG_LEVEL_DEBUG, 1,
         "Master: no instances of R%d available, P%d added to wait queue",
         resourceType, pid);
-    return -1; // Not enough resources available
+    return REQUEST_WAIT; // Not enough resources available
+  }
+
+  int availableBefore = resourceAvailable[resourceType];
+  resourceAvailable[resourceType] -= count;
+  setAllocation(index, resourceType, ALLOCATED(index, resourceType) + count);
+  int availableAfter = resourceAvailable[resourceType];
+
+  if (avoidDeadlocks && !stateIsSafe(index)) {
+    resourceAvailable[resourceType] += count;
+    setAllocation(index, resourceType, ALLOCATED(index, resourceType) - count);
+    if (!queued)
+      unsafeDeniedRequests++;
+    log_message(LOG_LEVEL_DEBUG, 1,
+                "Master: granting R%d to P%d would be unsafe, P%d must wait",
+                resourceType, pid, pid);
+    return REQUEST_WAIT;
   }
 
-  int availableBefore = resourceTable[resourceType].available;
-  resourceTable[resourceType].available -= count;
-  resourceTable[resourceType].allocated[index] += count;
-  int availableAfter = resourceTable[resourceType].available;
+  unsigned long currentSec, currentNano;
+  readClock(simClock, &currentSec, &currentNano);
 
-  immediateGrantedRequests++;
+  if (queued) {
+    waitingGrantedRequests++;
+  } else {
+    immediateGrantedRequests++;
+  }
+  traceEvent(queued ? TRACE_GRANT_QUEUED : TRACE_GRANT, pid, index,
+             resourceType, count);
   log_message(LOG_LEVEL_INFO, 1,
               "Master granting P%d request R%d at time %lu:%09lu. Available "
               "before: %d, after: %d",
-              pid, resourceType, simClock->seconds, simClock->nanoseconds,
-              availableBefore, availableAfter);
+              pid, resourceType, currentSec, currentNano, availableBefore,
+              availableAfter);
+  return REQUEST_GRANTED;
+}
+
+// A vector must name between one and VECTOR_MAX_ENTRIES distinct classes,
+// each with a positive count
+static bool vectorIsValid(const MessageA5 *msg) {
+  if (msg->vectorLength < 1 || msg->vectorLength > VECTOR_MAX_ENTRIES)
+    return false;
+  for (int i = 0; i < msg->vectorLength; i++) {
+    const ResourceCount *entry = &msg->vector[i];
+    if (entry->resourceType < 0 || entry->resourceType >= maxResources ||
+        entry->count <= 0)
+      return false;
+    for (int j = 0; j < i; j++) {
+      if (msg->vector[j].resourceType == entry->resourceType)
+        return false;
+    }
+  }
+  return true;
+}
+
+// allocateLocked() for a REQUEST_VECTOR: every entry is granted or none is
+static int allocateVectorLocked(const MessageA5 *msg, bool queued) {
+  pid_t pid = msg->senderPid;
+  int index = findProcessIndexByPID(pid);
+  if (index == -1 || processTable[index].state != PROCESS_RUNNING) {
+    log_message(LOG_LEVEL_ERROR, 0,
+                "Invalid or non-running PID: %d. Cannot request resources.",
+                pid);
+    return REQUEST_DENIED;
+  }
+
+  if (!queued)
+    totalRequests++;
+
+  if (!vectorIsValid(msg)) {
+    log_message(LOG_LEVEL_WARN, 0, "PID %d sent a malformed vector request.",
+                pid);
+    return REQUEST_DENIED;
+  }
+
+  const ResourceCount *vector = msg->vector;
+  for (int i = 0; !queued && i < msg->vectorLength; i++) {
+    traceEvent(TRACE_REQUEST, pid, index, vector[i].resourceType,
+               vector[i].count);
+  }
+  for (int i = 0; i < msg->vectorLength; i++) {
+    int r = vector[i].resourceType;
+    if (avoidDeadlocks &&
+        ALLOCATED(index, r) + vector[i].count > CLAIMED(index, r)) {
+      log_message(LOG_LEVEL_WARN, 0,
+                  "PID %d asked for %d of R%d beyond its claim of %d.", pid,
+                  vector[i].count, r, CLAIMED(index, r));
+      return REQUEST_DENIED;
+    }
+  }
+  for (int i = 0; i < msg->vectorLength; i++) {
+    if (resourceAvailable[vector[i].resourceType] < vector[i].count) {
+      log_message(
+          LOG_LEVEL_DEBUG, 1,
+          "Master: no instances of R%d available, P%d added to wait queue",
+          vector[i].resourceType, pid);
+      return REQUEST_WAIT;
+    }
+  }
+
+  for (int i = 0; i < msg->vectorLength; i++) {
+    int r = vector[i].resourceType;
+    resourceAvailable[r] -= vector[i].count;
+    setAllocation(index, r, ALLOCATED(index, r) + vector[i].count);
+  }
+
+  if (avoidDeadlocks && !stateIsSafe(index)) {
+    for (int i = 0; i < msg->vectorLength; i++) {
+      int r = vector[i].resourceType;
+      resourceAvailable[r] += vector[i].count;
+      setAllocation(index, r, ALLOCATED(index, r) - vector[i].count);
+    }
+    if (!queued)
+      unsafeDeniedRequests++;
+    log_message(LOG_LEVEL_DEBUG, 1,
+                "Master: granting %d classes to P%d would be unsafe, P%d "
+                "must wait",
+                msg->vectorLength, pid, pid);
+    return REQUEST_WAIT;
+  }
+
+  unsigned long currentSec, currentNano;
+  readClock(simClock, &currentSec, &currentNano);
+
+  if (queued) {
+    waitingGrantedRequests++;
+  } else {
+    immediateGrantedRequests++;
+  }
+  for (int i = 0; i < msg->vectorLength; i++) {
+    int r = vector[i].resourceType;
+    traceEvent(queued ? TRACE_GRANT_QUEUED : TRACE_GRANT, pid, index, r,
+               vector[i].count);
+    log_message(LOG_LEVEL_INFO, 1,
+                "Master granting P%d request R%d at time %lu:%09lu. Available "
+                "before: %d, after: %d",
+                pid, r, currentSec, currentNano,
+                resourceAvailable[r] + vector[i].count, resourceAvailable[r]);
+  }
+  return REQUEST_GRANTED;
+}
 
+static int allocateResource(pid_t pid, int resourceType, int count,
+                            bool queued) {
+  pthread_mutex_lock(&resourceTableMutex);
+  int result = allocateLocked(pid, resourceType, count, queued);
   pthread_mutex_unlock(&resourceTableMutex);
-  return 0; // Resource allocated successfully
+  return result;
 }
 
-int releaseResource(int pid, int resourceType, int count) {
+int requestResource(pid_t pid, int resourceType, int count) {
   log_message(LOG_LEVEL_DEBUG, 0,
-              "Attempting to release %d units of resource %d for PID %d", count,
+              "Attempting to request %d units of resource %d for PID %d", count,
               resourceType, pid);
+  return allocateResource(pid, resourceType, count, false);
+}
 
-  struct timespec ts;
-  clock_gettime(CLOCK_REALTIME, &ts);
-  ts.tv_sec += 2; // Wait for 2 seconds
+// Retries a request that had to wait, once its resource was freed
+int grantQueuedRequest(pid_t pid, int resourceType, int count) {
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Retrying queued request of PID %d for %d units of resource %d",
+              pid, count, resourceType);
+  return allocateResource(pid, resourceType, count, true);
+}
 
-  if (pthread_mutex_timedlock(&resourceTableMutex, &ts) != 0) {
-    log_message(LOG_LEVEL_ERROR, 0,
-                "Failed to acquire resourceTableMutex for releaseResource");
-    return -1;
+// Retries a queued REQUEST_VECTOR as a whole
+int grantQueuedVector(const MessageA5 *msg) {
+  pthread_mutex_lock(&resourceTableMutex);
+  int result = allocateVectorLocked(msg, true);
+  pthread_mutex_unlock(&resourceTableMutex);
+  return result;
+}
+
+// Resource class a vector request that was not granted should wait on: the
+// first one short of instances, or its first class if it was unsafe
+int vectorWaitingOn(const MessageA5 *msg) {
+  for (int i = 0; i < msg->vectorLength; i++) {
+    if (resourceAvailable[msg->vector[i].resourceType] < msg->vector[i].count)
+      return msg->vector[i].resourceType;
   }
-  log_message(LOG_LEVEL_DEBUG, 0,
-              "Acquired resourceTableMutex for releaseResource");
+  return msg->vector[0].resourceType;
+}
 
+// Instances of resourceType a vector message names, or 0
+int vectorCount(const MessageA5 *msg, int resourceType) {
+  for (int i = 0; i < msg->vectorLength; i++) {
+    if (msg->vector[i].resourceType == resourceType)
+      return msg->vector[i].count;
+  }
+  return 0;
+}
+
+// The caller holds resourceTableMutex
+static int releaseLocked(int pid, int resourceType, int count) {
   int index = findProcessIndexByPID(pid);
-  if (index == -1 || !isProcessRunning(pid)) {
+  if (index == -1 || processTable[index].state != PROCESS_RUNNING) {
     log_message(LOG_LEVEL_DEBUG, 0,
                 "Invalid or non-running PID: %d. Cannot release resources.",
                 pid);
-    pthread_mutex_unlock(&resourceTableMutex);
     return -1;
   }
 
-  if (resourceTable[resourceType].allocated[index] < count) {
+  if (ALLOCATED(index, resourceType) < count) {
     log_message(LOG_LEVEL_DEBUG, 0, "No resources to release for PID: %d.",
                 pid);
-    pthread_mutex_unlock(&resourceTableMutex);
     return -1;
   }
 
-  int availableBefore = resourceTable[resourceType].available;
-  resourceTable[resourceType].available += count;
-  resourceTable[resourceType].allocated[index] -= count;
-  int availableAfter = resourceTable[resourceType].available;
+  int availableBefore = resourceAvailable[resourceType];
+  resourceAvailable[resourceType] += count;
+  setAllocation(index, resourceType, ALLOCATED(index, resourceType) - count);
+  int availableAfter = resourceAvailable[resourceType];
+  noteFreedResource(resourceType);
+  traceEvent(TRACE_RELEASE, pid, index, resourceType, count);
+
+  unsigned long currentSec, currentNano;
+  readClock(simClock, &currentSec, &currentNano);
 
   log_message(LOG_LEVEL_INFO, 1,
               "Master has acknowledged Process P%d releasing R%d at time "
               "%lu:%09lu. Available before: %d, after: %d",
-              pid, resourceType, simClock->seconds, simClock->nanoseconds,
-              availableBefore, availableAfter);
+              pid, resourceType, currentSec, currentNano, availableBefore,
+              availableAfter);
+  return 0;
+}
+
+// Releases every entry of a RELEASE_VECTOR, or none if any is not held
+static int releaseVectorLocked(const MessageA5 *msg) {
+  int index = findProcessIndexByPID(msg->senderPid);
+  if (index == -1 || !vectorIsValid(msg)) {
+    log_message(LOG_LEVEL_DEBUG, 0, "Rejected vector release from PID %ld.",
+                msg->senderPid);
+    return -1;
+  }
+  for (int i = 0; i < msg->vectorLength; i++) {
+    if (ALLOCATED(index, msg->vector[i].resourceType) < msg->vector[i].count) {
+      log_message(LOG_LEVEL_DEBUG, 0, "No resources to release for PID: %ld.",
+                  msg->senderPid);
+      return -1;
+    }
+  }
+  for (int i = 0; i < msg->vectorLength; i++) {
+    if (releaseLocked(msg->senderPid, msg->vector[i].resourceType,
+                      msg->vector[i].count) != 0)
+      return -1; // Not running; nothing was released
+  }
+  return 0;
+}
+
+int releaseResource(int pid, int resourceType, int count) {
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Attempting to release %d units of resource %d for PID %d", count,
+              resourceType, pid);
+
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  ts.tv_sec += 2; // Wait for 2 seconds
+
+  if (pthread_mutex_timedlock(&resourceTableMutex, &ts) != 0) {
+    log_message(LOG_LEVEL_ERROR, 0,
+                "Failed to acquire resourceTableMutex for releaseResource");
+    return -1;
+  }
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Acquired resourceTableMutex for releaseResource");
+
+  int result = releaseLocked(pid, resourceType, count);
 
   pthread_mutex_unlock(&resourceTableMutex);
   log_message(LOG_LEVEL_DEBUG, 0,
               "Released resourceTableMutex for releaseResource");
 
-  return 0;
+  return result;
 }
 
-void releaseAllResourcesForProcess(int pid) {
-  pthread_mutex_lock(&resourceTableMutex);
-
+// Returns the instances given back, or -1. The caller holds the mutex.
+static int releaseAllLocked(int pid) {
   int index = findProcessIndexByPID(pid);
-  if (index == -1 || !isProcessRunning(pid)) {
+  if (index == -1 || processTable[index].state != PROCESS_RUNNING) {
     log_message(LOG_LEVEL_ERROR, 0,
                 "Cannot release resources. PID %d is invalid or not running.",
                 pid);
-    pthread_mutex_unlock(&resourceTableMutex);
-    return;
+    return -1;
   }
 
-  for (int resourceType = 0; resourceType < MAX_RESOURCES; resourceType++) {
-    log_message(LOG_LEVEL_INFO, 0,
-                "Trying to release resources for resourceType %d...",
-                resourceType);
-    int allocation = resourceTable[resourceType].allocated[index];
+  int released = 0;
+  const int *row = &ALLOCATED(index, 0);
+  for (int resourceType = 0; resourceType < maxResources; resourceType++) {
+    int allocation = row[resourceType];
     if (allocation > 0) {
       log_message(LOG_LEVEL_INFO, 0,
                   "PID %d has %d units of resource %d allocated.", pid,
                   allocation, resourceType);
-      resourceTable[resourceType].available += allocation;
-      resourceTable[resourceType].allocated[index] = 0;
+      resourceAvailable[resourceType] += allocation;
+      setAllocation(index, resourceType, 0);
+      noteFreedResource(resourceType);
+      traceEvent(TRACE_RELEASE, pid, index, resourceType, allocation);
+      released += allocation;
       log_message(LOG_LEVEL_INFO, 0,
                   "Released %d units of resource %d for PID: %d. Available: %d",
                   allocation, resourceType, pid,
-                  resourceTable[resourceType].available);
+                  resourceAvailable[resourceType]);
     }
   }
 
   log_message(LOG_LEVEL_INFO, 0, "All resources released for PID: %d.", pid);
+  return released;
+}
 
+void releaseAllResourcesForProcess(int pid) {
+  pthread_mutex_lock(&resourceTableMutex);
+  releaseAllLocked(pid);
+  pthread_mutex_unlock(&resourceTableMutex);
+}
+
+// Applies a batch of first-attempt requests and releases under a single hold
+// of resourceTableMutex. results[i] gets a REQUEST_* code for a request, or
+// for a release 0 (RELEASE_ALL: the instances given back) or -1; any other
+// command is answered REQUEST_DENIED. Single-class messages must already
+// have their resource type in range.
+void applyResourceBatch(const MessageA5 *const *messages, int count,
+                        int *results) {
+  pthread_mutex_lock(&resourceTableMutex);
+  for (int i = 0; i < count; i++) {
+    const MessageA5 *msg = messages[i];
+    if (msg->commandType == REQUEST_RESOURCE) {
+      results[i] =
+          allocateLocked(msg->senderPid, msg->resourceType, msg->count, false);
+    } else if (msg->commandType == RELEASE_RESOURCE) {
+      results[i] = releaseLocked(msg->senderPid, msg->resourceType, msg->count);
+    } else if (msg->commandType == REQUEST_VECTOR) {
+      results[i] = allocateVectorLocked(msg, false);
+    } else if (msg->commandType == RELEASE_VECTOR) {
+      results[i] = releaseVectorLocked(msg);
+    } else if (msg->commandType == RELEASE_ALL) {
+      results[i] = releaseAllLocked(msg->senderPid);
+    } else {
+      results[i] = REQUEST_DENIED;
+    }
+  }
   pthread_mutex_unlock(&resourceTableMutex);
 }
 
 bool unsafeSystem(void) {
-  if (!resourceTable) {
+  if (!resourceAvailable) {
     log_message(LOG_LEVEL_ERROR, 0, "Resource table is not initialized.");
     return true;
   }
-  int finish[MAX_PROCESSES] = {0};
 
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    for (int j = 0; j < MAX_RESOURCES; j++) {
-      if (resourceTable[j].allocated[i] > 0) {
-        finish[i] = 0;
-        log_message(LOG_LEVEL_DEBUG, 0,
-                    "Process P%d cannot finish; holds resources.", i);
-        break;
-      }
-    }
+  if (stateIsSafe(-1)) {
+    log_message(LOG_LEVEL_INFO, 0, "System is safe: All processes can finish.");
+    return false;
   }
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "System is unsafe: Not every process can finish.");
+  return true;
+}
 
-  bool systemIsSafe = true;
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    if (!finish[i]) {
-      log_message(LOG_LEVEL_DEBUG, 0,
-                  "System is unsafe: Process P%d cannot finish.", i);
-      systemIsSafe = false;
-      break;
+// Records a REGISTER_CLAIM vector as the sender's whole claim: the most of
+// each listed class it may hold at once, and none of any other. Claims are
+// only accepted while the process holds nothing, so declaring one can never
+// turn a safe state unsafe.
+int registerClaim(const MessageA5 *msg) {
+  pid_t pid = msg->senderPid;
+  pthread_mutex_lock(&resourceTableMutex);
+
+  int index = findProcessIndexByPID(pid);
+  bool valid = index != -1 && processTable[index].state == PROCESS_RUNNING &&
+               vectorIsValid(msg);
+  for (int i = 0; valid && i < msg->vectorLength; i++) {
+    valid = msg->vector[i].count <= resourceTotal[msg->vector[i].resourceType];
+  }
+  if (!valid) {
+    pthread_mutex_unlock(&resourceTableMutex);
+    log_message(LOG_LEVEL_ERROR, 0, "Rejected claim from PID %d.", pid);
+    return -1;
+  }
+
+  const int *row = &ALLOCATED(index, 0);
+  for (int r = 0; r < maxResources; r++) {
+    if (row[r] > 0) {
+      pthread_mutex_unlock(&resourceTableMutex);
+      log_message(LOG_LEVEL_ERROR, 0,
+                  "PID %d declared a claim while holding resources.", pid);
+      return -1;
     }
   }
 
-  if (systemIsSafe) {
-    log_message(LOG_LEVEL_INFO, 0, "System is safe: All processes can finish.");
+  int *claim = &CLAIMED(index, 0);
+  memset(claim, 0, maxResources * sizeof(int));
+  for (int i = 0; i < msg->vectorLength; i++) {
+    claim[msg->vector[i].resourceType] = msg->vector[i].count;
   }
+  pthread_mutex_unlock(&resourceTableMutex);
+  log_message(LOG_LEVEL_DEBUG, 0, "PID %d claims %d classes.", pid,
+              msg->vectorLength);
+  return 0;
+}
 
-  return !systemIsSafe;
+// Takes everything the process in slot index holds and marks it terminated.
+// Ending the worker itself is up to the onDeadlockVictim hook, which psmgmt
+// sets; the tables alone can be tested without real processes.
+void terminateDeadlockedProcess(int index) {
+  log_message(LOG_LEVEL_INFO, 0,
+              "Process P%d is deadlocked. Terminating process.",
+              processTable[index].pid);
+  traceEvent(TRACE_KILL, processTable[index].pid, index, -1, 0);
+  releaseAllResourcesForProcess(processTable[index].pid);
+  if (onDeadlockVictim != NULL)
+    onDeadlockVictim(index);
+  waitGraphUnblock(index);
+  terminatedByDeadlock++;
+  processTable[index].state = PROCESS_TERMINATED;
 }
 
+// Breaks deadlocks one victim at a time, cheapest first by victimCost, and
+// updates the detection result after each kill instead of starting over.
+// Only processes blocked on a request that can never be met are candidates.
 void resolveDeadlocks(void) {
-  if (!resourceTable) {
+  if (!resourceAvailable) {
     log_message(LOG_LEVEL_ERROR, 0, "Resource table is not initialized.");
     return;
   }
 
   deadlockDetectionRuns++;
-  bool deadlockResolved = false;
-
-  // Create arrays for the Banker's Algorithm
-  int work[MAX_RESOURCES];
-  bool finish[MAX_SIMULTANEOUS];
-  int need[MAX_PROCESSES][MAX_RESOURCES];
 
-  // Initialize work vector as a copy of available resources
-  for (int i = 0; i < MAX_RESOURCES; i++) {
-    work[i] = resourceTable[i].available;
-  }
-
-  // Initialize finish vector to false
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    finish[i] = false;
+  Detection detection;
+  int *candidates = malloc(processSlots * sizeof(int));
+  if (candidates == NULL || beginDetection(&detection) == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Deadlock detection failed.");
+    free(candidates);
+    return;
   }
 
-  // Calculate the need matrix
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    for (int j = 0; j < MAX_RESOURCES; j++) {
-      need[i][j] = resourceTable[j].total - resourceTable[j].allocated[i];
+  int kills = 0;
+  while (detection.unfinished > 0) {
+    int count = 0;
+    for (int i = 0; i < processSlots; i++) {
+      if (!detection.finish[i] && processTable[i].occupied &&
+          processTable[i].state == PROCESS_RUNNING)
+        candidates[count++] = i;
     }
-  }
+    if (count == 0)
+      break;
 
-  // Banker's Algorithm to detect deadlocks
-  bool progress = true;
-  while (progress) {
-    progress = false;
-    for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-      if (!finish[i]) {
-        bool canFinish = true;
-        for (int j = 0; j < MAX_RESOURCES; j++) {
-          if (resourceTable[j].allocated[i] > 0 && need[i][j] > work[j]) {
-            canFinish = false;
-            break;
-          }
-        }
-        if (canFinish) {
-          for (int j = 0; j < MAX_RESOURCES; j++) {
-            work[j] += resourceTable[j].allocated[i];
-          }
-          finish[i] = true;
-          progress = true;
-        }
-      }
-    }
+    int victim = chooseVictim(candidates, count);
+    recordVictim(victim, candidates, count);
+    removeFromDetection(&detection, victim); // While its row is still intact
+    terminateDeadlockedProcess(victim);
+    kills++;
   }
 
-  // Identify deadlocked processes
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    if (!finish[i] && processTable[i].occupied) {
-      log_message(LOG_LEVEL_INFO, 0,
-                  "Process P%d is deadlocked. Terminating process.",
-                  processTable[i].pid);
-      releaseAllResourcesForProcess(processTable[i].pid);
-      terminatedByDeadlock++;
-      processTable[i].state = PROCESS_TERMINATED;
-      deadlockResolved = true;
-    }
-  }
+  endDetection(&detection);
+  free(candidates);
+  traceEvent(TRACE_DEADLOCK_CHECK, -1, -1, -1, kills);
 
-  if (deadlockResolved) {
+  if (kills > 0) {
     log_message(LOG_LEVEL_INFO, 0,
-                "Deadlock resolved: All resources held by deadlocked processes "
-                "have been released.");
+                "Deadlock resolved: Terminated %d process%s and released "
+                "their resources.",
+                kills, kills == 1 ? "" : "es");
   } else {
     log_message(LOG_LEVEL_INFO, 0,
-                "No deadlock resolution needed: No resources were held by any "
-                "processes.");
+                "No deadlock resolution needed: No process is blocked for "
+                "good.");
+  }
+}
+
+// Table dumps render into one line buffer, reused across lines and dumps.
+// Later dumps skip rows whose owner is the same and that setAllocation()
+// has not marked in dirtyRows.
+static char *tableLine = NULL;
+static size_t tableLineSize = 0;
+static pid_t *dumpedPids = NULL;      // Slot owner at the last dump, 0 if free
+static int *dumpedAvailable = NULL;
+static bool *rowChanged = NULL; // Rows the current dump prints
+static int dumpedProcesses = 0;
+static int dumpedResources = 0;
+static int dumpsSinceFull = 0;
+
+static int digits(long value) {
+  int count = 1;
+  while (value >= 10) {
+    value /= 10;
+    count++;
   }
+  return count;
 }
 
-void logResourceTable() {
+void freeResourceTableLog(void) {
+  free(tableLine);
+  free(dumpedPids);
+  free(dirtyRows);
+  free(dumpedAvailable);
+  free(rowChanged);
+  tableLine = NULL;
+  dumpedPids = NULL;
+  dirtyRows = NULL;
+  dumpedAvailable = NULL;
+  rowChanged = NULL;
+  tableLineSize = 0;
+  dumpedProcesses = dumpedResources = dumpsSinceFull = 0;
+}
+
+// Sizes the dump state for the current table. Returns false if out of memory.
+static bool prepareTableLog(void) {
+  if (tableLine != NULL && dumpedProcesses == processSlots &&
+      dumpedResources == maxResources)
+    return true;
+
+  freeResourceTableLog();
+  tableLineSize = LOG_BUFFER_SIZE;
+  tableLine = malloc(tableLineSize);
+  dumpedPids = calloc(processSlots, sizeof(pid_t));
+  dirtyRows = calloc((processSlots + 63) / 64, sizeof(uint64_t));
+  dumpedAvailable = malloc(maxResources * sizeof(int));
+  rowChanged = malloc(processSlots * sizeof(bool));
+  if (tableLine == NULL || dumpedPids == NULL || dirtyRows == NULL ||
+      dumpedAvailable == NULL || rowChanged == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate resource table log.");
+    freeResourceTableLog();
+    return false;
+  }
+  for (int j = 0; j < maxResources; j++) {
+    dumpedAvailable[j] = -1; // Forces the first comparison to differ
+  }
+  dumpedProcesses = processSlots;
+  dumpedResources = maxResources;
+  return true;
+}
+
+// Appends one left-aligned cell at offset and returns the new offset
+static size_t appendCell(size_t offset, int width, const char *prefix,
+                         long value) {
+  if (offset >= tableLineSize)
+    return offset;
+  int written = snprintf(tableLine + offset, tableLineSize - offset,
+                         "%s%-*ld ", prefix, width - (int)strlen(prefix),
+                         value);
+  return written < 0 ? offset : offset + written;
+}
+
+static size_t appendLabel(int width, const char *label) {
+  int written = snprintf(tableLine, tableLineSize, "%-*s ", width, label);
+  return written < 0 ? 0 : (size_t)written;
+}
+
+// Renders the table, one band of columns at a time so a row never outgrows
+// a log line. With changesOnly, rows equal to the last dump are skipped, and
+// so is the whole table if nothing changed. Returns the process rows logged.
+static int renderResourceTable(bool changesOnly) {
+  if (!prepareTableLog())
+    return 0;
+
+  bool availableChanged = memcmp(dumpedAvailable, resourceAvailable,
+                                 maxResources * sizeof(int)) != 0;
+  int changedRows = 0;
+  long widestPid = 0;
+  for (int i = 0; i < processSlots; i++) {
+    pid_t pid = processTable[i].occupied ? processTable[i].pid : 0;
+    bool dirty = (dirtyRows[i / 64] >> (i % 64)) & 1;
+    rowChanged[i] =
+        pid != 0 && (!changesOnly || pid != dumpedPids[i] || dirty);
+    if (rowChanged[i])
+      changedRows++;
+    if (pid > widestPid)
+      widestPid = pid;
+  }
+
+  if (changesOnly && changedRows == 0 && !availableChanged)
+    return 0;
+
+  int labelWidth = 1 + digits(widestPid);
+  if (labelWidth < 4)
+    labelWidth = 4;
+  int cellWidth = 1 + digits(maxResources - 1);
+  if (digits(maxInstances) > cellWidth)
+    cellWidth = digits(maxInstances);
+  // Room for the log prefix on each line
+  int band = (int)(tableLineSize - 32 - labelWidth) / (cellWidth + 1);
+  if (band < 1)
+    band = 1;
+
   log_message(LOG_LEVEL_INFO, 0,
-              "---------------- Resource Table ----------------");
-
-  // Log header
-  char header[1024] = "    ";
-  for (int j = 0; j < MAX_RESOURCES; j++) {
-    char resourceHeader[16];
-    snprintf(resourceHeader, sizeof(resourceHeader), "R%-4d", j);
-    strcat(header, resourceHeader);
-  }
-  log_message(LOG_LEVEL_INFO, 0, header);
-
-  // Log resource availability
-  char availability[1024] = "Avl ";
-  for (int j = 0; j < MAX_RESOURCES; j++) {
-    char resourceAvailability[16];
-    snprintf(resourceAvailability, sizeof(resourceAvailability), "%-4d",
-             resourceTable[j].available);
-    strcat(availability, resourceAvailability);
-  }
-  log_message(LOG_LEVEL_INFO, 0, availability);
-
-  // Log each process's resource allocation
-  for (int i = 0; i < MAX_SIMULTANEOUS; i++) {
-    if (processTable[i].occupied) {
-      char buffer[1024];
-      snprintf(buffer, sizeof(buffer), "P%-3d ", processTable[i].pid);
-      for (int j = 0; j < MAX_RESOURCES; j++) {
-        char resourceAllocation[16];
-        snprintf(resourceAllocation, sizeof(resourceAllocation), "%-4d",
-                 resourceTable[j].allocated[i]);
-        strcat(buffer, resourceAllocation);
+              "---------------- Resource Table%s ----------------",
+              changesOnly ? " (changes)" : "");
+  for (int first = 0; first < maxResources; first += band) {
+    int last = first + band < maxResources ? first + band : maxResources;
+
+    size_t offset = appendLabel(labelWidth, "");
+    for (int j = first; j < last; j++) {
+      offset = appendCell(offset, cellWidth, "R", j);
+    }
+    log_message(LOG_LEVEL_INFO, 0, "%s", tableLine);
+
+    offset = appendLabel(labelWidth, "Avl");
+    for (int j = first; j < last; j++) {
+      offset = appendCell(offset, cellWidth, "", resourceAvailable[j]);
+    }
+    log_message(LOG_LEVEL_INFO, 0, "%s", tableLine);
+
+    for (int i = 0; i < processSlots; i++) {
+      if (!rowChanged[i])
+        continue;
+      char label[16];
+      snprintf(label, sizeof(label), "P%d", processTable[i].pid);
+      offset = appendLabel(labelWidth, label);
+      for (int j = first; j < last; j++) {
+        offset = appendCell(offset, cellWidth, "", ALLOCATED(i, j));
       }
-      log_message(LOG_LEVEL_INFO, 0, buffer);
+      log_message(LOG_LEVEL_INFO, 0, "%s", tableLine);
     }
   }
   log_message(LOG_LEVEL_INFO, 0,
               "------------------------------------------------");
+
+  // Remember what was printed for the next delta
+  memcpy(dumpedAvailable, resourceAvailable, maxResources * sizeof(int));
+  for (int i = 0; i < processSlots; i++) {
+    dumpedPids[i] = processTable[i].occupied ? processTable[i].pid : 0;
+  }
+  memset(dirtyRows, 0, (processSlots + 63) / 64 * sizeof(uint64_t));
+  return changedRows;
+}
+
+void logResourceTable(void) {
+  renderResourceTable(false);
+  dumpsSinceFull = 0;
+}
+
+// Periodic dump: only rows that changed since the last one, with a full
+// table every RESOURCE_TABLE_FULL_DUMPS so the log can be read from anywhere.
+// Returns the process rows logged.
+int logResourceTableChanges(void) {
+  if (++dumpsSinceFull >= RESOURCE_TABLE_FULL_DUMPS) {
+    dumpsSinceFull = 0;
+    return renderResourceTable(false);
+  }
+  return renderResourceTable(true);
 }
 
 void logStatistics(void) {
@@ -351,6 +933,10 @@ void logStatistics(void) {
               successfullyTerminated);
   log_message(LOG_LEVEL_INFO, 1, "Deadlock detection runs: %d",
               deadlockDetectionRuns);
+  if (avoidDeadlocks) {
+    log_message(LOG_LEVEL_INFO, 1, "Requests deferred as unsafe: %d",
+                unsafeDeniedRequests);
+  }
 
   if (deadlockDetectionRuns > 0) {
     float averageTerminations =
@@ -359,4 +945,5 @@ void logStatistics(void) {
                 "Average terminations per deadlock detection run: %.2f",
                 averageTerminations);
   }
+  logGrantLatencies();
 }
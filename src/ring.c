@@ -0,0 +1,150 @@
+#include "ring.h"
+#include "reactor.h"
+#include "user_process.h"
+
+RingTransport *ringTransport = NULL; // Shared ring segment, one ring per slot
+MessageRing *workerRing = NULL;      // Ring owned by this worker, if any
+int ringTransportShmId = -1;
+
+const char *transportTypeToString(TransportType type) {
+  switch (type) {
+  case TRANSPORT_MSQ:
+    return "msq";
+  case TRANSPORT_RING:
+    return "ring";
+  default:
+    return "Unknown";
+  }
+}
+
+int initializeRingTransport(void) {
+  size_t size = sizeof(RingTransport) + processSlots * sizeof(MessageRing);
+  ringTransport = (RingTransport *)createSharedMemory(
+      SHM_PATH, SHM_PROJ_ID_RING, size, "Message Rings", &ringTransportShmId);
+  if (ringTransport == NULL)
+    return ERROR_INIT_SHM;
+
+  ringTransport->ringCount = processSlots;
+  ringTransport->enabled = 1;
+
+  log_message(LOG_LEVEL_DEBUG, 0, "Ring transport initialized with %d rings.",
+              ringTransport->ringCount);
+  return SUCCESS;
+}
+
+int attachWorkerRing(pid_t pid) {
+  key_t key = getSharedMemoryKey(SHM_PATH, SHM_PROJ_ID_RING);
+  if (key == -1 || shmget(key, 0, 0) == -1) {
+    return -1; // psmgmt did not create the ring segment
+  }
+
+  ringTransport = (RingTransport *)attachSharedMemory(
+      SHM_PATH, SHM_PROJ_ID_RING, sizeof(RingTransport), "Message Rings");
+  if (ringTransport == NULL || !ringTransport->enabled) {
+    return -1;
+  }
+
+  // psmgmt binds the ring when it registers us, which may lag the fork
+  for (int attempt = 0; attempt < RING_ATTACH_RETRIES; attempt++) {
+    for (int i = 0; i < ringTransport->ringCount; i++) {
+      if (atomic_load_explicit(&ringTransport->rings[i].owner,
+                               memory_order_acquire) == pid) {
+        workerRing = &ringTransport->rings[i];
+        log_message(LOG_LEVEL_DEBUG, 0, "Worker %d bound to ring %d", pid, i);
+        return 0;
+      }
+    }
+    usleep(1000);
+  }
+
+  log_message(LOG_LEVEL_WARN, 0,
+              "Worker %d: no ring assigned, falling back to message queue",
+              pid);
+  return -1;
+}
+
+void assignRing(int index, pid_t pid) {
+  if (ringTransport == NULL || index < 0 || index >= ringTransport->ringCount)
+    return;
+
+  MessageRing *ring = &ringTransport->rings[index];
+  atomic_store_explicit(&ring->head, 0, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, 0, memory_order_relaxed);
+  atomic_store_explicit(&ring->owner, pid, memory_order_release);
+}
+
+int ringPush(MessageRing *ring, const MessageA5 *msg) {
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (tail - head == RING_CAPACITY) {
+    return -1; // Full, psmgmt has not caught up yet
+  }
+
+  ring->messages[tail & (RING_CAPACITY - 1)] = *msg;
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+  return 0;
+}
+
+int ringPop(MessageRing *ring, MessageA5 *msg) {
+  unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head == tail) {
+    return -1; // Empty
+  }
+
+  *msg = ring->messages[head & (RING_CAPACITY - 1)];
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+  return 0;
+}
+
+int drainRings(MessageA5 *batch, int maxMessages) {
+  static int nextRing = 0; // Rotate the starting ring so no slot starves
+  if (ringTransport == NULL)
+    return 0;
+
+  int count = 0;
+  int ringCount = ringTransport->ringCount;
+  for (int n = 0; n < ringCount && count < maxMessages; n++) {
+    MessageRing *ring = &ringTransport->rings[(nextRing + n) % ringCount];
+    if (atomic_load_explicit(&ring->owner, memory_order_acquire) == 0)
+      continue;
+    while (count < maxMessages && ringPop(ring, &batch[count]) == 0) {
+      count++;
+    }
+  }
+  nextRing = (nextRing + 1) % ringCount;
+  return count;
+}
+
+bool ringsPending(void) {
+  if (ringTransport == NULL)
+    return false;
+
+  for (int i = 0; i < ringTransport->ringCount; i++) {
+    MessageRing *ring = &ringTransport->rings[i];
+    if (atomic_load(&ring->tail) != atomic_load(&ring->head))
+      return true;
+  }
+  return false;
+}
+
+int sendToMaster(const MessageA5 *msg) {
+  if (workerRing == NULL) {
+    if (sendMessage(msqId, MSG_TYPE_MASTER, msg) != 0)
+      return -1;
+    notifyMaster();
+    return 0;
+  }
+
+  while (ringPush(workerRing, msg) == -1) {
+    usleep(1000); // Back off until psmgmt drains the ring
+  }
+
+  // Pairs with the store to masterSleeping before psmgmt rechecks the rings
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load_explicit(&ringTransport->masterSleeping,
+                           memory_order_relaxed)) {
+    notifyMaster();
+  }
+  return 0;
+}
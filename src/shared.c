@@ -1,4 +1,5 @@
 #include "shared.h"
+#include "logring.h"
 
 int getCurrentChildren(void) { return currentChildren; }
 
@@ -32,6 +33,40 @@ void *attachSharedMemory(const char *path, int proj_id, size_t size,
   return shmPtr;
 }
 
+// Like attachSharedMemory(), but always starts from a fresh zeroed segment.
+// A segment left behind by an earlier run may be too small for this one.
+void *createSharedMemory(const char *path, int proj_id, size_t size,
+                         const char *segmentName, int *shmIdOut) {
+  key_t key = getSharedMemoryKey(path, proj_id);
+  int staleId = shmget(key, 0, 0);
+  if (staleId >= 0) {
+    shmctl(staleId, IPC_RMID, NULL);
+  }
+
+  int shmId = shmget(key, size, SHM_PERMISSIONS | IPC_CREAT | IPC_EXCL);
+  if (shmId < 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to create %s (%zu bytes): %s",
+                segmentName, size, strerror(errno));
+    return NULL;
+  }
+
+  void *shmPtr = shmat(shmId, NULL, 0);
+  if (shmPtr == (void *)-1) {
+    log_message(LOG_LEVEL_ERROR, 0,
+                "Failed to attach to %s shared memory due to: %s", segmentName,
+                strerror(errno));
+    shmctl(shmId, IPC_RMID, NULL);
+    return NULL;
+  }
+
+  if (shmIdOut != NULL) {
+    *shmIdOut = shmId;
+  }
+  log_message(LOG_LEVEL_DEBUG, 0, "Created %s shared memory (%zu bytes)",
+              segmentName, size);
+  return shmPtr;
+}
+
 int detachSharedMemory(void **shmPtr, const char *segmentName) {
   if (shmPtr == NULL || *shmPtr == NULL) {
     log_message(LOG_LEVEL_ERROR, 0,
@@ -64,15 +99,8 @@ const char *processTypeToString(ProcessType type) {
   }
 }
 
-void log_message(int level, int logToFile, const char *format, ...) {
-  if (level < currentLogLevel)
-    return; // Skip logging if the level is below the current setting
-
-  if (pthread_mutex_lock(&logMutex) != 0) {
-    fprintf(stderr, "Error locking log mutex\n");
-    return;
-  }
-
+// Called through log_message(), which has already checked the level
+void writeLogMessage(int level, int logToFile, const char *format, ...) {
   char buffer[LOG_BUFFER_SIZE]; // Buffer to hold the formatted message
   int offset =
       snprintf(buffer, sizeof(buffer), "[%s] ",
@@ -80,10 +108,21 @@ void log_message(int level, int logToFile, const char *format, ...) {
 
   va_list args;
   va_start(args, format);
-  vsnprintf(buffer + offset, sizeof(buffer) - offset, format,
-            args); // Format the rest of the message
+  int length = vsnprintf(buffer + offset, sizeof(buffer) - offset, format,
+                         args); // Format the rest of the message
   va_end(args);
 
+  length = length < 0 ? offset : offset + length;
+  if (length > (int)sizeof(buffer) - 1)
+    length = sizeof(buffer) - 1;
+  if (logRingPush(level, logToFile, buffer, length))
+    return; // The flusher thread writes it
+
+  if (pthread_mutex_lock(&logMutex) != 0) {
+    fprintf(stderr, "Error locking log mutex\n");
+    return;
+  }
+
   // Always output to stderr
   fprintf(stderr, "%s\n", buffer);
 
@@ -110,64 +149,59 @@ key_t getSharedMemoryKey(const char *path, int proj_id) {
   return key;
 }
 
-int sendMessage(int msqId, const void *msg, size_t msgSize) {
-  better_sem_wait(clockSem); // Synchronize access to shared resources
+int sendMessage(int msqId, long mtype, const MessageA5 *msg) {
+  MessageEnvelope envelope = {.mtype = mtype, .body = *msg};
 
-  int result = msgsnd(msqId, msg, msgSize - sizeof(long),
-                      0); // Subtract sizeof(long) to exclude the mtype
+  // The kernel serializes queue access; clockSem only guards the clock
+  int result;
+  while ((result = msgsnd(msqId, &envelope, sizeof(envelope.body), 0)) == -1 &&
+         errno == EINTR) {
+    continue; // Retry sends interrupted by signals
+  }
   if (result == -1) {
     log_message(
         LOG_LEVEL_ERROR, 0,
         "[SEND] Error: Failed to send message. msqId: %d, Error: %s (%d)",
         msqId, strerror(errno), errno);
-    better_sem_post(clockSem);
     return -1;
   }
 
-  log_message(LOG_LEVEL_DEBUG, 0, "[SEND] Success: Message sent. msqId: %d",
-              msqId);
-  better_sem_post(clockSem);
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "[SEND] Success: Message sent. msqId: %d, mtype: %ld", msqId,
+              mtype);
   return 0;
 }
 
-int receiveMessage(int msqId, void *msg, size_t msgSize, int flags) {
-  pid_t myPid = getpid();
-  while (true) {
-    if (better_sem_wait(clockSem) == 0) {
-      ssize_t result = msgrcv(msqId, msg, msgSize - sizeof(long), 0, flags);
-      if (result == -1) {
-        if (errno == ENOMSG) { // No message of the desired type was found
-          log_message(LOG_LEVEL_DEBUG, 0,
-                      "[RECEIVE] Info: No message of desired type available. "
-                      "Continuing.");
-          better_sem_post(clockSem);
-          return -1;
-        }
-        log_message(LOG_LEVEL_ERROR, 0,
-                    "[RECEIVE] Error: Failed to receive message. msqId: %d, "
-                    "Error: %s (%d)",
-                    msqId, strerror(errno), errno);
-        better_sem_post(clockSem);
-        return -1;
-      }
-      MessageA5 *receivedMsg = (MessageA5 *)msg;
-      if (receivedMsg->senderPid == myPid) {
-        log_message(
-            LOG_LEVEL_DEBUG, 0,
-            "[RECEIVE] Info: Ignoring message from same PID. Continuing.");
-        better_sem_post(clockSem);
-        continue;
-      }
-      log_message(LOG_LEVEL_DEBUG, 0,
-                  "[RECEIVE] Success: Message received. msqId: %d, PID: %ld, "
-                  "CommandType: %d, ResourceType: %d, Count: %d",
-                  msqId, (long)receivedMsg->senderPid, receivedMsg->commandType,
-                  receivedMsg->resourceType, receivedMsg->count);
-      better_sem_post(clockSem);
-      return 0;
+int receiveMessage(int msqId, long mtype, MessageA5 *msg, int flags) {
+  MessageEnvelope envelope;
+  bool blocking = !(flags & IPC_NOWAIT);
+
+  ssize_t result;
+  while ((result = msgrcv(msqId, &envelope, sizeof(envelope.body), mtype,
+                          flags)) == -1 &&
+         errno == EINTR && blocking) {
+    continue; // Keep waiting for our reply across signals
+  }
+  int savedErrno = errno;
+
+  if (result == -1) {
+    if (savedErrno != ENOMSG) {
+      log_message(LOG_LEVEL_ERROR, 0,
+                  "[RECEIVE] Error: Failed to receive message. msqId: %d, "
+                  "Error: %s (%d)",
+                  msqId, strerror(savedErrno), savedErrno);
     }
-    usleep(10000); // Sleep for 10ms to avoid busy-waiting
+    errno = savedErrno;
+    return -1;
   }
+
+  *msg = envelope.body;
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "[RECEIVE] Success: Message received. msqId: %d, PID: %ld, "
+              "CommandType: %d, ResourceType: %d, Count: %d",
+              msqId, msg->senderPid, msg->commandType, msg->resourceType,
+              msg->count);
+  return 0;
 }
 
 void cleanupSharedResources(void) {
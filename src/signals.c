@@ -35,16 +35,13 @@ void parentSignalHandler(int sig) {
 }
 
 void setupParentSignalHandlers(void) {
-  struct sigaction sa_parent, sa_child;
+  struct sigaction sa_parent;
   memset(&sa_parent, 0, sizeof(sa_parent));
-  memset(&sa_child, 0, sizeof(sa_child));
   sa_parent.sa_handler = parentSignalHandler;
-  sa_child.sa_handler = childExitHandler;
   sigfillset(&sa_parent.sa_mask);
-  sigfillset(&sa_child.sa_mask);
-
-  sigaction(SIGCHLD, &sa_child, NULL);
 
+  // SIGCHLD is not handled here: the reactor reads it from a signalfd and
+  // reaps children from the main loop.
   int signals[] = {SIGINT, SIGTERM, SIGALRM};
   for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
     if (sigaction(signals[i], &sa_parent, NULL) == -1) {
@@ -55,22 +52,6 @@ void setupParentSignalHandlers(void) {
   }
 }
 
-void childExitHandler(int sig) {
-  (void)sig;
-  pid_t pid;
-  int status;
-
-  while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
-    // Find the index of the process that has terminated
-    int index = findProcessIndexByPID(pid);
-    if (index != -1) {
-      handleTermination(pid);
-      log_message(LOG_LEVEL_INFO, 0,
-                  "Child process PID: %d terminated and cleaned up.", pid);
-    }
-  }
-}
-
 void setupTimeout(int seconds) {
   struct sigaction sa;
   memset(&sa, 0, sizeof(sa));
@@ -82,18 +63,30 @@ void setupTimeout(int seconds) {
   alarm(seconds);
 }
 
+// Ends the run at MAX_RUNTIME. Only clears keepRunning and signals worker
+// processes: the main loop then leaves and cleans up, so nothing is freed
+// under it. Worker threads have task IDs, not PIDs, and are stopped and
+// joined by stopWorkerTasks() on the way out. Logs with signalSafeLog(),
+// since the log ring may be mid-push in the code this interrupted.
 void timeoutHandler(int signum) {
-  log_message(LOG_LEVEL_INFO, 0, "Timeout signal received, signum: %d.",
-              signum);
+  char buffer[256];
+  snprintf(buffer, sizeof(buffer),
+           "OSS (PID: %d): Timeout signal %d received.", getpid(), signum);
+  signalSafeLog(LOG_LEVEL_INFO, buffer);
   keepRunning = 0;
+  if (workerRuntime == RUNTIME_THREAD)
+    return;
 
-  for (int i = 0; i < maxProcesses; i++) {
-    if (processTable[i].occupied && processTable[i].state == PROCESS_RUNNING) {
+  int signalled = 0;
+  for (int i = 0; i < processSlots; i++) {
+    if (processTable[i].occupied &&
+        (processTable[i].state == PROCESS_RUNNING ||
+         processTable[i].state == PROCESS_POOLED)) {
       kill(processTable[i].pid, SIGTERM); // Send SIGTERM to each running child
-      log_message(LOG_LEVEL_INFO, 0, "Sent SIGTERM to PID: %d.",
-                  processTable[i].pid);
+      signalled++;
     }
   }
-
-  cleanupAndExit();
+  snprintf(buffer, sizeof(buffer), "OSS (PID: %d): Sent SIGTERM to %d workers.",
+           getpid(), signalled);
+  signalSafeLog(LOG_LEVEL_INFO, buffer);
 }
@@ -0,0 +1,75 @@
+#include "simclock.h"
+
+void readClock(const SimulatedClock *clock, unsigned long *seconds,
+               unsigned long *nanoseconds) {
+  unsigned int start;
+  unsigned long sec, nano;
+
+  do {
+    start = atomic_load_explicit(&clock->sequence, memory_order_acquire);
+    if (start & 1) {
+      continue; // Writer is mid-update, sample again
+    }
+    sec = atomic_load_explicit(&clock->seconds, memory_order_relaxed);
+    nano = atomic_load_explicit(&clock->nanoseconds, memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+  } while ((start & 1) ||
+           start != atomic_load_explicit(&clock->sequence,
+                                         memory_order_relaxed));
+
+  *seconds = sec;
+  *nanoseconds = nano;
+}
+
+void writeClock(SimulatedClock *clock, unsigned long seconds,
+                unsigned long nanoseconds) {
+  unsigned int sequence =
+      atomic_load_explicit(&clock->sequence, memory_order_relaxed);
+
+  atomic_store_explicit(&clock->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&clock->seconds, seconds, memory_order_relaxed);
+  atomic_store_explicit(&clock->nanoseconds, nanoseconds,
+                        memory_order_relaxed);
+  atomic_store_explicit(&clock->sequence, sequence + 2, memory_order_release);
+
+  if (atomic_load(&clock->waiters) > 0) {
+    syscall(SYS_futex, &clock->sequence, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+  }
+}
+
+void advanceClock(SimulatedClock *clock, unsigned long nanoseconds) {
+  // Only the writer calls this, so the current value can be read directly
+  unsigned long sec =
+      atomic_load_explicit(&clock->seconds, memory_order_relaxed);
+  unsigned long nano =
+      atomic_load_explicit(&clock->nanoseconds, memory_order_relaxed) +
+      nanoseconds;
+
+  sec += nano / NANOSECONDS_IN_SECOND;
+  nano %= NANOSECONDS_IN_SECOND;
+  writeClock(clock, sec, nano);
+}
+
+unsigned long clockNanoseconds(const SimulatedClock *clock) {
+  unsigned long sec, nano;
+  readClock(clock, &sec, &nano);
+  return sec * NANOSECONDS_IN_SECOND + nano;
+}
+
+void waitForClock(SimulatedClock *clock, unsigned long target) {
+  struct timespec timeout = {0, CLOCK_WAIT_TIMEOUT_NS};
+
+  while (keepRunning) {
+    unsigned int sequence = atomic_load(&clock->sequence);
+    if (clockNanoseconds(clock) >= target)
+      return;
+
+    // Sleep until psmgmt publishes a new time; the timeout covers a writer
+    // that raced our registration
+    atomic_fetch_add(&clock->waiters, 1);
+    syscall(SYS_futex, &clock->sequence, FUTEX_WAIT, sequence, &timeout, NULL,
+            0);
+    atomic_fetch_sub(&clock->waiters, 1);
+  }
+}
@@ -0,0 +1,223 @@
+#include "stats.h"
+#include "cleanup.h"
+#include "process.h"
+#include "queue.h"
+#include "resource.h"
+#include "simclock.h"
+
+#include <time.h>
+
+int statsShmId = -1; // Only set in psmgmt, which owns the segment
+static struct timespec lastPublish;
+
+#define STORE(field, value)                                                    \
+  atomic_store_explicit(&statsHeader->field, (value), memory_order_relaxed)
+
+static size_t alignStats(size_t offset) {
+  return (offset + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+}
+
+// Creates the segment, sized from maxResources and processSlots
+int openStats(void) {
+  size_t resourceOffset = alignStats(sizeof(StatsHeader));
+  size_t workerOffset =
+      alignStats(resourceOffset + (size_t)maxResources * sizeof(ResourceStats));
+  size_t latencyOffset =
+      alignStats(workerOffset + (size_t)processSlots * sizeof(WorkerStats));
+  size_t size = latencyOffset + (size_t)(maxResources + 1) * LATENCY_KINDS *
+                                    LATENCY_CLOCKS * sizeof(Histogram);
+
+  statsHeader = (StatsHeader *)createSharedMemory(
+      SHM_PATH, SHM_PROJ_ID_STATS, size, "Statistics", &statsShmId);
+  if (statsHeader == NULL)
+    return ERROR_INIT_SHM;
+
+  memset(statsHeader, 0, size);
+  memcpy(statsHeader->magic, STATS_MAGIC, sizeof(statsHeader->magic));
+  statsHeader->version = STATS_VERSION;
+  statsHeader->headerSize = sizeof(StatsHeader);
+  statsHeader->resourceCount = maxResources;
+  statsHeader->processSlots = processSlots;
+  statsHeader->maxInstances = maxInstances;
+  statsHeader->psmgmtPid = getpid();
+  statsHeader->resourceOffset = resourceOffset;
+  statsHeader->workerOffset = workerOffset;
+  statsHeader->latencyOffset = latencyOffset;
+  statsHeader->size = size;
+  STORE(running, 1);
+  publishStats(true);
+  return SUCCESS;
+}
+
+// Copies psmgmt's counters into the segment. Unless forced, does nothing if
+// the last snapshot is under STATS_PUBLISH_INTERVAL_NS old.
+void publishStats(bool force) {
+  if (statsHeader == NULL || statsShmId == -1)
+    return;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long elapsed = (now.tv_sec - lastPublish.tv_sec) * NANOSECONDS_IN_SECOND +
+                 (now.tv_nsec - lastPublish.tv_nsec);
+  if (!force && elapsed < STATS_PUBLISH_INTERVAL_NS)
+    return;
+  lastPublish = now;
+
+  if (simClock != NULL) // Already detached when the final snapshot is taken
+    STORE(simulatedTime, clockNanoseconds(simClock));
+  STORE(currentChildren, currentChildren);
+  STORE(launched, totalLaunched);
+  STORE(exited, successfullyTerminated);
+  STORE(requests, totalRequests);
+  STORE(immediateGrants, immediateGrantedRequests);
+  STORE(queuedGrants, waitingGrantedRequests);
+  STORE(unsafeDenials, unsafeDeniedRequests);
+  STORE(deadlockChecks, deadlockDetectionRuns);
+  STORE(deadlockKills, terminatedByDeadlock);
+
+  ResourceStats *resources = STATS_RESOURCES(statsHeader);
+  for (int r = 0; r < statsHeader->resourceCount; r++) {
+    atomic_store_explicit(&resources[r].inUse,
+                          resourceTotal[r] - resourceAvailable[r],
+                          memory_order_relaxed);
+    atomic_store_explicit(&resources[r].queueDepth,
+                          queueLength(&resourceQueues[r]),
+                          memory_order_relaxed);
+  }
+  atomic_fetch_add_explicit(&statsHeader->published, 1, memory_order_release);
+}
+
+// Publishes the final numbers, tells readers the run is over and removes
+// the segment once they detach. Workers and readers only detach.
+void closeStats(void) {
+  if (statsHeader == NULL)
+    return;
+
+  if (statsShmId != -1) {
+    publishStats(true);
+    STORE(running, 0);
+    cleanupSharedMemorySegment(statsShmId, "Statistics");
+    statsShmId = -1;
+  }
+  shmdt(statsHeader);
+  statsHeader = NULL;
+}
+
+// Claims the counters of the worker in pid's process table slot, attaching
+// the segment first in a workerA5 process, and zeroes what the slot's last
+// worker left there. NULL if nothing is published.
+WorkerStats *workerStats(pid_t pid) {
+  if (statsHeader == NULL && attachStats(false) != SUCCESS)
+    return NULL;
+
+  PCB *slot = attachWorkerSlot(pid);
+  if (slot == NULL || slot - processTable >= statsHeader->processSlots)
+    return NULL;
+
+  WorkerStats *stats = &STATS_WORKERS(statsHeader)[slot - processTable];
+  atomic_store_explicit(&stats->requests, 0, memory_order_relaxed);
+  atomic_store_explicit(&stats->grants, 0, memory_order_relaxed);
+  atomic_store_explicit(&stats->waits, 0, memory_order_relaxed);
+  atomic_store_explicit(&stats->denials, 0, memory_order_relaxed);
+  atomic_store_explicit(&stats->releases, 0, memory_order_relaxed);
+  atomic_store_explicit(&stats->pid, pid, memory_order_relaxed);
+  atomic_store_explicit(&stats->active, 1, memory_order_relaxed);
+  return stats;
+}
+
+// Grant latency histogram for resourceType, or for all grants when it is -1.
+// A vector grant is recorded there once and under each of its classes.
+Histogram *grantLatency(int resourceType, LatencyKind kind,
+                        LatencyClock clock) {
+  if (statsHeader == NULL || resourceType >= statsHeader->resourceCount)
+    return NULL;
+  if (resourceType < 0)
+    resourceType = statsHeader->resourceCount;
+
+  Histogram *histograms =
+      (Histogram *)((char *)statsHeader + statsHeader->latencyOffset);
+  return &histograms[((size_t)resourceType * LATENCY_KINDS + kind) *
+                         LATENCY_CLOCKS +
+                     clock];
+}
+
+void recordGrantLatency(int resourceType, LatencyKind kind,
+                        uint64_t simulatedNs, uint64_t wallNs) {
+  Histogram *simulated = grantLatency(resourceType, kind, LATENCY_SIMULATED);
+  Histogram *wall = grantLatency(resourceType, kind, LATENCY_WALL);
+  if (simulated == NULL || wall == NULL)
+    return;
+  histogramRecord(simulated, simulatedNs);
+  histogramRecord(wall, wallNs);
+}
+
+static void formatLatency(char *buffer, size_t size, uint64_t ns) {
+  if (ns < 1000) {
+    snprintf(buffer, size, "%luns", (unsigned long)ns);
+  } else if (ns < 1000000) {
+    snprintf(buffer, size, "%.1fus", ns / 1e3);
+  } else if (ns < NANOSECONDS_IN_SECOND) {
+    snprintf(buffer, size, "%.1fms", ns / 1e6);
+  } else {
+    snprintf(buffer, size, "%.2fs", ns / 1e9);
+  }
+}
+
+// "p50/p99/p99.9/max" of one histogram
+static void formatPercentiles(char *buffer, size_t size,
+                              const Histogram *histogram) {
+  static const double percentiles[] = {50.0, 99.0, 99.9};
+  char value[32];
+  size_t offset = 0;
+  buffer[0] = '\0';
+  for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+    formatLatency(value, sizeof(value),
+                  histogramPercentile(histogram, percentiles[i]));
+    offset += snprintf(buffer + offset, size - offset, "%s/", value);
+  }
+  formatLatency(value, sizeof(value),
+                atomic_load_explicit(&histogram->max, memory_order_relaxed));
+  snprintf(buffer + offset, size - offset, "%s", value);
+}
+
+static void logLatencyLine(int level, int resourceType, LatencyKind kind) {
+  const Histogram *simulated =
+      grantLatency(resourceType, kind, LATENCY_SIMULATED);
+  const Histogram *wall = grantLatency(resourceType, kind, LATENCY_WALL);
+  uint64_t count = atomic_load_explicit(&wall->count, memory_order_relaxed);
+  if (count == 0)
+    return;
+
+  char label[16];
+  char simulatedText[128];
+  char wallText[128];
+  if (resourceType < 0) {
+    snprintf(label, sizeof(label), "all");
+  } else {
+    snprintf(label, sizeof(label), "R%d", resourceType);
+  }
+  formatPercentiles(simulatedText, sizeof(simulatedText), simulated);
+  formatPercentiles(wallText, sizeof(wallText), wall);
+  log_message(level, 1, "  %-9s %-4s %7lu grants  simulated %s  wall %s",
+              kind == LATENCY_IMMEDIATE ? "immediate" : "queued", label,
+              (unsigned long)count, simulatedText, wallText);
+}
+
+// Logs grant latency percentiles for immediate and queued grants. Each
+// resource class that saw grants gets its own line at debug level only, as
+// there may be hundreds.
+void logGrantLatencies(void) {
+  if (statsHeader == NULL)
+    return;
+
+  log_message(LOG_LEVEL_INFO, 1,
+              "Grant latency, p50/p99/p99.9/max from request to grant:");
+  for (int kind = 0; kind < LATENCY_KINDS; kind++) {
+    logLatencyLine(LOG_LEVEL_INFO, -1, kind);
+    if (currentLogLevel > LOG_LEVEL_DEBUG)
+      continue;
+    for (int r = 0; r < statsHeader->resourceCount; r++) {
+      logLatencyLine(LOG_LEVEL_DEBUG, r, kind);
+    }
+  }
+}
@@ -0,0 +1,29 @@
+#include "stats.h"
+#include "shared.h"
+
+// Attaching side of the statistics segment, kept apart so psmgmt-stat links
+// without psmgmt's resource tables
+
+StatsHeader *statsHeader = NULL; // Attached stats segment, or NULL
+
+// Attaches the segment psmgmt published. Fails quietly if there is none or
+// it was written by an incompatible build.
+int attachStats(bool readOnly) {
+  int shmId = shmget(getSharedMemoryKey(SHM_PATH, SHM_PROJ_ID_STATS), 0, 0);
+  if (shmId == -1)
+    return -1;
+
+  StatsHeader *header =
+      (StatsHeader *)shmat(shmId, NULL, readOnly ? SHM_RDONLY : 0);
+  if (header == (void *)-1)
+    return -1;
+  if (memcmp(header->magic, STATS_MAGIC, sizeof(header->magic)) != 0 ||
+      header->version != STATS_VERSION ||
+      header->headerSize != sizeof(StatsHeader)) {
+    shmdt(header);
+    errno = EPROTO;
+    return -1;
+  }
+  statsHeader = header;
+  return SUCCESS;
+}
@@ -0,0 +1,252 @@
+#include "tasks.h"
+#include "process.h"
+#include "reactor.h"
+#include "worker.h"
+
+typedef struct {
+  WorkerContext worker; // First, so the worker's hooks can find the task
+  pthread_t thread;
+  pthread_mutex_t lock; // Guards the mailbox, stopping and killed
+  pthread_cond_t ready;
+  MessageA5 mailbox[TASK_MAILBOX_SIZE];
+  int head;
+  int count;
+  bool stopping; // psmgmt is shutting down, receive() gives up
+  bool killed;   // Deadlock victim, receive() answers KILLED
+  int index;     // Process table slot, held until psmgmt reaps the task
+} WorkerTask;
+
+static WorkerTask **tasks = NULL; // By process table slot, while alive
+static int issuedTasks = 0;
+
+// Inbound channel; any task produces, psmgmt is the only consumer
+static pthread_mutex_t channelLock = PTHREAD_MUTEX_INITIALIZER;
+static MessageA5 *channel = NULL;
+static int channelHead = 0;
+static int channelCount = 0;
+static int channelCapacity = 0;
+
+// Tasks that returned and wait for psmgmt to join them
+static pthread_mutex_t finishedLock = PTHREAD_MUTEX_INITIALIZER;
+static pid_t *finished = NULL;
+static int finishedCount = 0;
+
+int initWorkerTasks(void) {
+  tasks = calloc(processSlots, sizeof(WorkerTask *));
+  finished = malloc(processSlots * sizeof(pid_t));
+  channel = malloc(TASK_CHANNEL_INITIAL * sizeof(MessageA5));
+  if (tasks == NULL || finished == NULL || channel == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate worker tasks.");
+    return -1;
+  }
+  channelCapacity = TASK_CHANNEL_INITIAL;
+  return SUCCESS;
+}
+
+// ID for the next task; psmgmt registers it before starting the task
+pid_t nextTaskId(void) {
+  if (issuedTasks >= maxProcesses)
+    return -1;
+  return TASK_ID_BASE + issuedTasks++;
+}
+
+static WorkerTask *findTask(pid_t id) {
+  if (tasks == NULL || id < TASK_ID_BASE)
+    return NULL;
+  int index = findProcessIndexByPID(id);
+  return index == -1 ? NULL : tasks[index];
+}
+
+static int sendToChannel(WorkerContext *worker, const MessageA5 *msg) {
+  (void)worker;
+  pthread_mutex_lock(&channelLock);
+  if (channelCount == channelCapacity) {
+    MessageA5 *grown = malloc(2 * channelCapacity * sizeof(MessageA5));
+    if (grown == NULL) {
+      pthread_mutex_unlock(&channelLock);
+      return -1;
+    }
+    for (int i = 0; i < channelCount; i++) {
+      grown[i] = channel[(channelHead + i) % channelCapacity];
+    }
+    free(channel);
+    channel = grown;
+    channelHead = 0;
+    channelCapacity *= 2;
+  }
+  channel[(channelHead + channelCount) % channelCapacity] = *msg;
+  channelCount++;
+  pthread_mutex_unlock(&channelLock);
+
+  notifyMaster();
+  return 0;
+}
+
+static int receiveFromMailbox(WorkerContext *worker, MessageA5 *reply) {
+  WorkerTask *task = (WorkerTask *)worker;
+  pthread_mutex_lock(&task->lock);
+  while (task->count == 0 && !task->stopping && !task->killed) {
+    pthread_cond_wait(&task->ready, &task->lock);
+  }
+  if (task->count == 0) {
+    bool killed = task->killed;
+    pthread_mutex_unlock(&task->lock);
+    if (!killed)
+      return -1;
+    *reply = (MessageA5){.status = REPLY_KILLED};
+    return 0;
+  }
+  *reply = task->mailbox[task->head];
+  task->head = (task->head + 1) % TASK_MAILBOX_SIZE;
+  task->count--;
+  pthread_mutex_unlock(&task->lock);
+  return 0;
+}
+
+static void *runTask(void *arg) {
+  WorkerTask *task = arg;
+  runWorker(&task->worker);
+
+  // Stands in for SIGCHLD
+  pthread_mutex_lock(&finishedLock);
+  finished[finishedCount++] = task->worker.id;
+  pthread_mutex_unlock(&finishedLock);
+  notifyMaster();
+  return NULL;
+}
+
+static void freeTask(WorkerTask *task) {
+  tasks[task->index] = NULL;
+  freeWorkerContext(&task->worker);
+  pthread_mutex_destroy(&task->lock);
+  pthread_cond_destroy(&task->ready);
+  free(task);
+}
+
+// Starts the worker loop for id on its own thread. psmgmt registers id in
+// the process table first. Returns 0 or -1.
+int startWorkerTask(pid_t id) {
+  int index = id < TASK_ID_BASE ? -1 : findProcessIndexByPID(id);
+  if (index == -1 || tasks[index] != NULL)
+    return -1;
+  WorkerTask *task = calloc(1, sizeof(WorkerTask));
+  if (task == NULL || initWorkerContext(&task->worker, id) != 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate task %d.", id);
+    free(task);
+    return -1;
+  }
+  task->worker.send = sendToChannel;
+  task->worker.receive = receiveFromMailbox;
+  pthread_mutex_init(&task->lock, NULL);
+  pthread_cond_init(&task->ready, NULL);
+  task->index = index;
+  tasks[index] = task;
+
+  // Tasks block every signal, so psmgmt's handlers and signalfd see them
+  sigset_t all, previous;
+  sigfillset(&all);
+  pthread_sigmask(SIG_SETMASK, &all, &previous);
+  pthread_attr_t attr;
+  pthread_attr_init(&attr);
+  pthread_attr_setstacksize(&attr, TASK_STACK_SIZE);
+  int error = pthread_create(&task->thread, &attr, runTask, task);
+  pthread_attr_destroy(&attr);
+  pthread_sigmask(SIG_SETMASK, &previous, NULL);
+  if (error != 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to start task %d: %s", id,
+                strerror(error));
+    freeTask(task);
+    return -1;
+  }
+  return 0;
+}
+
+int drainTaskChannel(MessageA5 *batch, int maxMessages) {
+  pthread_mutex_lock(&channelLock);
+  int count = channelCount < maxMessages ? channelCount : maxMessages;
+  for (int i = 0; i < count; i++) {
+    batch[i] = channel[channelHead];
+    channelHead = (channelHead + 1) % channelCapacity;
+  }
+  channelCount -= count;
+  pthread_mutex_unlock(&channelLock);
+  return count;
+}
+
+// Replies addressed to a task that already finished are dropped, like
+// messages left in the queue for a process that exited
+int deliverToTask(pid_t id, const MessageA5 *reply) {
+  WorkerTask *task = findTask(id);
+  if (task == NULL)
+    return -1;
+
+  pthread_mutex_lock(&task->lock);
+  if (task->count == TASK_MAILBOX_SIZE) {
+    pthread_mutex_unlock(&task->lock);
+    log_message(LOG_LEVEL_ERROR, 0, "Mailbox of task %d is full.", id);
+    return -1;
+  }
+  task->mailbox[(task->head + task->count) % TASK_MAILBOX_SIZE] = *reply;
+  task->count++;
+  pthread_cond_signal(&task->ready);
+  pthread_mutex_unlock(&task->lock);
+  return 0;
+}
+
+// Marks a deadlock victim that is not blocked on a queued request. It stops
+// at its next check of running; psmgmt no longer answers it, so a reply it
+// is still waiting for reads as KILLED.
+void killWorkerTask(pid_t id) {
+  WorkerTask *task = findTask(id);
+  if (task == NULL)
+    return;
+
+  atomic_store(&task->worker.running, false);
+  pthread_mutex_lock(&task->lock);
+  task->killed = true;
+  pthread_cond_signal(&task->ready);
+  pthread_mutex_unlock(&task->lock);
+}
+
+// Joins one finished task and returns its ID, or -1 if none has finished
+pid_t reapWorkerTask(void) {
+  pthread_mutex_lock(&finishedLock);
+  pid_t id = finishedCount > 0 ? finished[--finishedCount] : -1;
+  pthread_mutex_unlock(&finishedLock);
+
+  WorkerTask *task = findTask(id);
+  if (task != NULL) {
+    pthread_join(task->thread, NULL);
+    freeTask(task);
+  }
+  return id;
+}
+
+// Stops and joins every task still running, at the end of the simulation
+void stopWorkerTasks(void) {
+  if (tasks == NULL)
+    return;
+
+  keepRunning = 0; // Releases tasks waiting on the clock
+  for (int i = 0; i < processSlots; i++) {
+    WorkerTask *task = tasks[i];
+    if (task == NULL)
+      continue;
+    atomic_store(&task->worker.running, false);
+    pthread_mutex_lock(&task->lock);
+    task->stopping = true;
+    pthread_cond_signal(&task->ready);
+    pthread_mutex_unlock(&task->lock);
+    pthread_join(task->thread, NULL);
+    freeTask(task);
+  }
+
+  free(tasks);
+  free(finished);
+  free(channel);
+  tasks = NULL;
+  finished = NULL;
+  channel = NULL;
+  issuedTasks = finishedCount = channelHead = channelCount = 0;
+  channelCapacity = 0;
+}
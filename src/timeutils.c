@@ -1,4 +1,5 @@
 #include "timeutils.h"
+#include "simclock.h"
 
 static double simSpeedFactor = TIMEKEEPER_SIM_SPEED_FACTOR;
 
@@ -7,8 +8,7 @@ static struct timespec startTime;
 void initializeTimeTracking(void) {
   if (better_sem_wait(clockSem) == 0) {
     if (!simClock->initialized) {
-      simClock->seconds = 0;
-      simClock->nanoseconds = 0;
+      writeClock(simClock, 0, 0);
       simClock->initialized = 1;
 
       // Set the start time for actual time tracking
@@ -26,16 +26,8 @@ void initializeTimeTracking(void) {
 }
 
 void simulateTimeProgression(void) {
-  if (better_sem_wait(clockSem) == 0) {
-    long increment = (long)(250000000L * simSpeedFactor);
-    simClock->nanoseconds += increment;
-    while (simClock->nanoseconds >= 1000000000L) {
-      simClock->seconds++;
-      simClock->nanoseconds -= 1000000000L;
-    }
-
-    better_sem_post(clockSem);
-  }
+  long increment = (long)(250000000L * simSpeedFactor);
+  advanceClock(simClock, increment);
 }
 
 void trackActualTime(void) {
@@ -45,19 +37,14 @@ void trackActualTime(void) {
     return;
   }
 
-  if (better_sem_wait(clockSem) == 0) {
-    // Calculate elapsed time
-    long elapsedSec = currentTime.tv_sec - startTime.tv_sec;
-    long elapsedNano = currentTime.tv_nsec - startTime.tv_nsec;
-    if (elapsedNano < 0) { // Handle the case where nanoseconds wrap
-      elapsedSec--;
-      elapsedNano += 1000000000;
-    }
-
-    // Store the elapsed time
-    actualTime->seconds = elapsedSec;
-    actualTime->nanoseconds = elapsedNano;
-
-    better_sem_post(clockSem);
+  // Calculate elapsed time
+  long elapsedSec = currentTime.tv_sec - startTime.tv_sec;
+  long elapsedNano = currentTime.tv_nsec - startTime.tv_nsec;
+  if (elapsedNano < 0) { // Handle the case where nanoseconds wrap
+    elapsedSec--;
+    elapsedNano += 1000000000;
   }
+
+  // Publish the elapsed time
+  writeClock(actualTime, elapsedSec, elapsedNano);
 }
@@ -0,0 +1,99 @@
+#define _GNU_SOURCE // mremap()
+#include "trace.h"
+#include "resource.h"
+#include "simclock.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+TraceHeader *traceHeader = NULL; // Mapped trace file, NULL without -e
+static TraceRecord *traceRecords = NULL;
+static int traceFd = -1;
+
+static size_t traceLength(uint64_t records) {
+  return sizeof(TraceHeader) + records * sizeof(TraceRecord);
+}
+
+static int mapTrace(uint64_t capacity) {
+  if (ftruncate(traceFd, traceLength(capacity)) == -1)
+    return -1;
+
+  void *mapping;
+  if (traceHeader == NULL) {
+    mapping = mmap(NULL, traceLength(capacity), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, traceFd, 0);
+  } else {
+    mapping = mremap(traceHeader, traceLength(traceHeader->capacity),
+                     traceLength(capacity), MREMAP_MAYMOVE);
+  }
+  if (mapping == MAP_FAILED)
+    return -1;
+
+  traceHeader = mapping;
+  traceRecords = (TraceRecord *)(traceHeader + 1);
+  traceHeader->capacity = capacity;
+  return 0;
+}
+
+int openTrace(const char *path) {
+  traceFd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (traceFd == -1 || mapTrace(TRACE_GROW_RECORDS) == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to open trace file %s: %s", path,
+                strerror(errno));
+    closeTrace();
+    return -1;
+  }
+
+  memcpy(traceHeader->magic, TRACE_MAGIC, sizeof(traceHeader->magic));
+  traceHeader->version = TRACE_VERSION;
+  traceHeader->recordSize = sizeof(TraceRecord);
+  atomic_store(&traceHeader->count, 0);
+  return 0;
+}
+
+// Cuts the file down to the records written and unmaps it
+void closeTrace(void) {
+  if (traceHeader != NULL) {
+    uint64_t count = atomic_load(&traceHeader->count);
+    size_t length = traceLength(traceHeader->capacity);
+    traceHeader->capacity = count;
+    munmap(traceHeader, length);
+    if (ftruncate(traceFd, traceLength(count)) == -1) {
+      log_message(LOG_LEVEL_WARN, 0, "Failed to trim trace file: %s",
+                  strerror(errno));
+    }
+  }
+  if (traceFd != -1)
+    close(traceFd);
+  traceHeader = NULL;
+  traceRecords = NULL;
+  traceFd = -1;
+}
+
+// Appends one record. Use traceEvent(), which skips the call without -e.
+void recordTraceEvent(int type, pid_t pid, int index, int resourceType,
+                      int count) {
+  uint64_t position = atomic_load_explicit(&traceHeader->count,
+                                           memory_order_relaxed);
+  if (position == traceHeader->capacity &&
+      mapTrace(traceHeader->capacity + TRACE_GROW_RECORDS) == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Trace file full, tracing stopped: %s",
+                strerror(errno));
+    closeTrace();
+    return;
+  }
+
+  TraceRecord *record = &traceRecords[position];
+  record->time = simClock != NULL ? clockNanoseconds(simClock) : 0;
+  record->pid = pid;
+  record->index = index;
+  record->resourceType = resourceType;
+  record->count = count;
+  record->available = resourceType >= 0 && resourceType < maxResources
+                          ? resourceAvailable[resourceType]
+                          : -1;
+  record->type = type;
+  record->reserved = 0;
+  atomic_store_explicit(&traceHeader->count, position + 1,
+                        memory_order_release);
+}
@@ -0,0 +1,137 @@
+#include "trace.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Reading side of the trace, kept apart so psmgmt-trace links without
+// psmgmt's resource tables
+
+int loadTrace(const char *path, TraceView *view) {
+  memset(view, 0, sizeof(*view));
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  struct stat status;
+  if (fstat(fd, &status) == -1 ||
+      (size_t)status.st_size < sizeof(TraceHeader)) {
+    close(fd);
+    errno = EINVAL;
+    return -1;
+  }
+  void *mapping = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapping == MAP_FAILED)
+    return -1;
+
+  view->header = mapping;
+  view->length = status.st_size;
+  if (memcmp(view->header->magic, TRACE_MAGIC, sizeof(view->header->magic)) !=
+          0 ||
+      view->header->version != TRACE_VERSION ||
+      view->header->recordSize != sizeof(TraceRecord)) {
+    unloadTrace(view);
+    errno = EINVAL;
+    return -1;
+  }
+
+  // A live trace may hold fewer records than the file has room for
+  uint64_t fits = (view->length - sizeof(TraceHeader)) / sizeof(TraceRecord);
+  view->count = atomic_load_explicit(&view->header->count,
+                                     memory_order_acquire);
+  if (view->count > fits)
+    view->count = fits;
+  view->records = (const TraceRecord *)(view->header + 1);
+  return 0;
+}
+
+void unloadTrace(TraceView *view) {
+  if (view->header != NULL)
+    munmap((void *)view->header, view->length);
+  memset(view, 0, sizeof(*view));
+}
+
+const char *traceEventName(int type) {
+  static const char *const names[TRACE_EVENT_TYPES] = {
+      "launch", "request", "grant",          "grant_queued", "wait",
+      "deny",   "release", "deadlock_check", "kill",         "exit"};
+  return type >= 0 && type < TRACE_EVENT_TYPES ? names[type] : "unknown";
+}
+
+// Text reproduces psmgmt's log lines, spec the assignment's wording with
+// processes named by slot, csv the raw fields. Returns snprintf's result.
+int formatTraceRecord(const TraceRecord *record, TraceFormat format,
+                      char *buffer, size_t size) {
+  unsigned long sec = record->time / ONE_SECOND;
+  unsigned long nano = record->time % ONE_SECOND;
+  int r = record->resourceType;
+  bool text = format == TRACE_FORMAT_TEXT;
+  int who = text ? record->pid : record->index;
+
+  if (format == TRACE_FORMAT_CSV) {
+    return snprintf(buffer, size, "%lu.%09lu,%s,%d,%d,%d,%d,%d", sec, nano,
+                    traceEventName(record->type), record->pid, record->index,
+                    r, record->count, record->available);
+  }
+
+  switch (record->type) {
+  case TRACE_LAUNCH:
+    return snprintf(buffer, size,
+                    "Master launching P%d (PID %d) at time %lu:%09lu",
+                    record->index, record->pid, sec, nano);
+  case TRACE_REQUEST:
+    return snprintf(buffer, size,
+                    "Master has detected Process P%d requesting R%d at time "
+                    "%lu:%09lu",
+                    who, r, sec, nano);
+  case TRACE_GRANT:
+  case TRACE_GRANT_QUEUED:
+    if (text)
+      return snprintf(buffer, size,
+                      "Master granting P%d request R%d at time %lu:%09lu. "
+                      "Available before: %d, after: %d",
+                      who, r, sec, nano, record->available + record->count,
+                      record->available);
+    return snprintf(buffer, size,
+                    "Master granting P%d request R%d at time %lu:%09lu", who, r,
+                    sec, nano);
+  case TRACE_WAIT:
+    return snprintf(buffer, size,
+                    "Master: no instances of R%d available, P%d added to wait "
+                    "queue at time %lu:%09lu",
+                    r, who, sec, nano);
+  case TRACE_DENY:
+    return snprintf(buffer, size,
+                    "Master denying P%d request R%d at time %lu:%09lu", who, r,
+                    sec, nano);
+  case TRACE_RELEASE:
+    if (text)
+      return snprintf(buffer, size,
+                      "Master has acknowledged Process P%d releasing R%d at "
+                      "time %lu:%09lu. Available before: %d, after: %d",
+                      who, r, sec, nano, record->available - record->count,
+                      record->available);
+    return snprintf(buffer, size,
+                    "Master has acknowledged Process P%d releasing R%d at time "
+                    "%lu:%09lu",
+                    who, r, sec, nano);
+  case TRACE_DEADLOCK_CHECK:
+    return snprintf(buffer, size,
+                    "Master running deadlock detection at time %lu:%09lu: %d "
+                    "processes terminated",
+                    sec, nano, record->count);
+  case TRACE_KILL:
+    return snprintf(buffer, size,
+                    "Master terminating P%d to remove deadlock at time "
+                    "%lu:%09lu",
+                    who, sec, nano);
+  case TRACE_EXIT:
+    return snprintf(buffer, size,
+                    "Master has detected P%d (PID %d) terminated at time "
+                    "%lu:%09lu",
+                    record->index, record->pid, sec, nano);
+  default:
+    return snprintf(buffer, size, "Unknown event %u at time %lu:%09lu",
+                    record->type, sec, nano);
+  }
+}
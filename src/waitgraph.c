@@ -0,0 +1,199 @@
+#include "waitgraph.h"
+#include "detect.h"
+#include "resource.h"
+#include "simclock.h"
+
+#include <stdint.h>
+
+static int *waitingOn = NULL;    // Resource class each slot waits on, or -1
+static int *waitingCount = NULL; // Instances that request is waiting for
+static unsigned long *blockedSince = NULL; // Simulated time it blocked
+static uint64_t *holderBits = NULL;        // Holder bit row per resource
+static int holderWords = 0;
+
+// Search state, sized once so a check never allocates
+static int *searchStack = NULL;
+static int *members = NULL;
+static uint64_t *visited = NULL;
+static bool *resourceSeen = NULL;
+static int *work = NULL;
+
+#define HOLDER_ROW(resourceType)                                               \
+  (&holderBits[(size_t)(resourceType) * holderWords])
+
+int initWaitGraph(void) {
+  freeWaitGraph();
+
+  holderWords = (processSlots + 63) / 64;
+  waitingOn = malloc(processSlots * sizeof(int));
+  waitingCount = calloc(processSlots, sizeof(int));
+  blockedSince = calloc(processSlots, sizeof(unsigned long));
+  holderBits = calloc((size_t)maxResources * holderWords, sizeof(uint64_t));
+  searchStack = malloc(processSlots * sizeof(int));
+  members = malloc(processSlots * sizeof(int));
+  visited = malloc(holderWords * sizeof(uint64_t));
+  resourceSeen = malloc(maxResources * sizeof(bool));
+  work = aligned_alloc(64, allocationStride * sizeof(int));
+  if (waitingOn == NULL || waitingCount == NULL || blockedSince == NULL ||
+      holderBits == NULL || searchStack == NULL || members == NULL ||
+      visited == NULL || resourceSeen == NULL || work == NULL) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to allocate the wait-for graph.");
+    freeWaitGraph();
+    return -1;
+  }
+
+  for (int i = 0; i < processSlots; i++) {
+    waitingOn[i] = -1;
+  }
+  // Pick up anything already allocated, one process row at a time
+  for (int i = 0; i < processSlots; i++) {
+    for (int r = 0; r < maxResources; r++) {
+      if (ALLOCATED(i, r) > 0)
+        HOLDER_ROW(r)[i / 64] |= 1ULL << (i % 64);
+    }
+  }
+  return 0;
+}
+
+void freeWaitGraph(void) {
+  free(waitingOn);
+  free(waitingCount);
+  free(blockedSince);
+  free(holderBits);
+  free(searchStack);
+  free(members);
+  free(visited);
+  free(resourceSeen);
+  free(work);
+  waitingOn = NULL;
+  waitingCount = NULL;
+  blockedSince = NULL;
+  holderBits = NULL;
+  searchStack = NULL;
+  members = NULL;
+  visited = NULL;
+  resourceSeen = NULL;
+  work = NULL;
+  holderWords = 0;
+}
+
+// Adds the edges from index to every current holder of resourceType
+void waitGraphBlock(int index, int resourceType, int count) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots)
+    return;
+  waitingOn[index] = resourceType;
+  waitingCount[index] = count;
+  blockedSince[index] = simClock != NULL ? clockNanoseconds(simClock) : 0;
+}
+
+// Drops every edge out of index: it was granted, moved on, or terminated
+void waitGraphUnblock(int index) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots)
+    return;
+  waitingOn[index] = -1;
+  waitingCount[index] = 0;
+}
+
+// Resource class index is blocked on, or -1
+int waitGraphWaitingOn(int index) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots)
+    return -1;
+  return waitingOn[index];
+}
+
+// True unless index is blocked on a request that work cannot meet
+bool waitGraphRequestFits(int index, const int *work) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots ||
+      waitingOn[index] == -1)
+    return true;
+  return waitingCount[index] <= work[waitingOn[index]];
+}
+
+// Simulated nanoseconds index has been blocked on its current request
+unsigned long waitGraphWaitTime(int index, unsigned long now) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots ||
+      waitingOn[index] == -1 || now < blockedSince[index])
+    return 0;
+  return now - blockedSince[index];
+}
+
+// Called by setAllocation(), so edges into index follow its allocations
+void waitGraphHoldingChanged(int index, int resourceType, bool holds) {
+  if (holderBits == NULL)
+    return;
+  uint64_t bit = 1ULL << (index % 64);
+  if (holds) {
+    HOLDER_ROW(resourceType)[index / 64] |= bit;
+  } else {
+    HOLDER_ROW(resourceType)[index / 64] &= ~bit;
+  }
+}
+
+// Looks for a deadlock involving the process that just blocked in slot
+// index. Only the part of the graph reachable from index is searched; a
+// cycle there is necessary but, with multi-instance resources, not
+// sufficient, so the reachable set is then reduced with the detection
+// algorithm against the blocked requests. Returns the number of deadlocked
+// slots and points deadlocked at them, valid until the next call.
+int findDeadlockFrom(int index, const int **deadlocked) {
+  if (waitingOn == NULL || index < 0 || index >= processSlots ||
+      waitingOn[index] == -1)
+    return 0;
+
+  memset(visited, 0, holderWords * sizeof(uint64_t));
+  memset(resourceSeen, 0, maxResources * sizeof(bool));
+
+  int count = 0;
+  int top = 0;
+  bool cycle = false;
+  visited[index / 64] |= 1ULL << (index % 64);
+  members[count++] = index;
+  searchStack[top++] = index;
+
+  while (top > 0) {
+    int p = searchStack[--top];
+    int r = waitingOn[p];
+    if (r == -1 || resourceSeen[r])
+      continue; // Not blocked, or its holders are already queued
+    resourceSeen[r] = true;
+
+    const uint64_t *holders = HOLDER_ROW(r);
+    for (int w = 0; w < holderWords; w++) {
+      for (uint64_t bits = holders[w]; bits != 0; bits &= bits - 1) {
+        int q = w * 64 + __builtin_ctzll(bits);
+        if (q == p)
+          continue; // Asking for more of a class it already holds
+        if (q == index)
+          cycle = true;
+        uint64_t bit = 1ULL << (q % 64);
+        if (visited[q / 64] & bit)
+          continue;
+        visited[q / 64] |= bit;
+        members[count++] = q;
+        searchStack[top++] = q;
+      }
+    }
+  }
+
+  if (!cycle)
+    return 0;
+
+  // Every holder of a class the reachable set waits on is itself in the set,
+  // so processes outside it cannot free anything the set is waiting for
+  const DetectionKernel *kernel = detectionKernel();
+  memcpy(work, resourceAvailable, allocationStride * sizeof(int));
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (int i = 0; i < count; i++) {
+      int p = members[i];
+      if (!waitGraphRequestFits(p, work))
+        continue;
+      kernel->rowAccumulate(work, &ALLOCATED(p, 0), allocationStride);
+      members[i--] = members[--count];
+      progress = true;
+    }
+  }
+  *deadlocked = members;
+  return count;
+}
@@ -0,0 +1,333 @@
+#include "worker.h"
+#include "process.h"
+#include "resource.h"
+#include "simclock.h"
+
+#include <time.h>
+
+#define B 250000000L // Upper bound in nanoseconds for random timing
+#define TERMINATION_CHECK_INTERVAL 250000000L // Check termination every 250ms
+#define REQUEST_PROBABILITY 90 // 90% probability of requesting vs releasing
+#define VECTOR_PROBABILITY 25  // Share of requests that ask for several classes
+#define VECTOR_CLASSES 3       // Classes tried for such a request
+
+int initWorkerContext(WorkerContext *worker, pid_t id) {
+  memset(worker, 0, sizeof(*worker));
+  worker->id = id;
+  worker->seed = (unsigned int)id;
+  worker->heldResources = calloc(maxResources, sizeof(int));
+  worker->maxClaim = calloc(maxResources, sizeof(int));
+  if (worker->heldResources == NULL || worker->maxClaim == NULL) {
+    freeWorkerContext(worker);
+    return -1;
+  }
+  atomic_store(&worker->running, true);
+  return 0;
+}
+
+void freeWorkerContext(WorkerContext *worker) {
+  free(worker->heldResources);
+  free(worker->maxClaim);
+  worker->heldResources = NULL;
+  worker->maxClaim = NULL;
+}
+
+static const char *actionName(int action) {
+  switch (action) {
+  case REQUEST_RESOURCE:
+  case REQUEST_VECTOR:
+    return "request";
+  case RELEASE_ALL:
+    return "release all";
+  default:
+    return "release";
+  }
+}
+
+static unsigned long wallNanoseconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * ONE_SECOND + now.tv_nsec;
+}
+
+static void sendResourceRequest(WorkerContext *worker, const MessageA5 *msg) {
+  if (msg->commandType == REQUEST_RESOURCE ||
+      msg->commandType == REQUEST_VECTOR) {
+    statsCount(worker->stats, requests);
+    if (worker->stats != NULL) { // Grant latency starts here
+      worker->requestSentAt = clockNanoseconds(simClock);
+      worker->requestSentAtWall = wallNanoseconds();
+    }
+  } else {
+    statsCount(worker->stats, releases);
+  }
+  if (worker->send(worker, msg) == 0) {
+    log_message(LOG_LEVEL_DEBUG, 0,
+                "Worker %d: Sent message to %s resource R%d", worker->id,
+                actionName(msg->commandType), msg->resourceType);
+  } else {
+    log_message(LOG_LEVEL_ERROR, 0,
+                "Worker %d: Failed to send message to %s resource R%d",
+                worker->id, actionName(msg->commandType), msg->resourceType);
+  }
+}
+
+// Records how long request took to be granted, overall and per class
+static void recordLatency(WorkerContext *worker, const MessageA5 *request,
+                          bool queued) {
+  LatencyKind kind = queued ? LATENCY_QUEUED : LATENCY_IMMEDIATE;
+  unsigned long simulated = clockNanoseconds(simClock) - worker->requestSentAt;
+  unsigned long wall = wallNanoseconds() - worker->requestSentAtWall;
+
+  recordGrantLatency(-1, kind, simulated, wall);
+  if (request->commandType == REQUEST_VECTOR) {
+    for (int i = 0; i < request->vectorLength; i++) {
+      recordGrantLatency(request->vector[i].resourceType, kind, simulated,
+                         wall);
+    }
+  } else {
+    recordGrantLatency(request->resourceType, kind, simulated, wall);
+  }
+}
+
+// Blocks until psmgmt decides on request. Returns the instances moved, or -1
+// if the worker was killed or lost psmgmt and must stop.
+static int waitForResourceResponse(WorkerContext *worker,
+                                   const MessageA5 *request) {
+  int *heldResources = worker->heldResources;
+  MessageA5 response;
+  bool queued = false;
+
+  // A QUEUED reply only says the decision is pending, so keep waiting for
+  // the one that follows it
+  do {
+    if (worker->receive(worker, &response) != 0) {
+      log_message(LOG_LEVEL_ERROR, 0,
+                  "Worker %d: Lost contact with psmgmt while waiting for reply",
+                  worker->id);
+      atomic_store(&worker->running, false);
+      return -1;
+    }
+    if (response.status == REPLY_QUEUED) {
+      queued = true;
+      statsCount(worker->stats, waits);
+      log_message(LOG_LEVEL_DEBUG, 0, "Worker %d: Waiting for R%d", worker->id,
+                  request->resourceType);
+    }
+  } while (response.status == REPLY_QUEUED);
+
+  log_message(LOG_LEVEL_DEBUG, 0,
+              "Worker %d: Received response for resource %s", worker->id,
+              actionName(request->commandType));
+
+  if (response.status == REPLY_KILLED) {
+    // psmgmt already took back everything we held
+    log_message(LOG_LEVEL_INFO, 0, "Worker %d: Killed to break a deadlock",
+                worker->id);
+    memset(heldResources, 0, maxResources * sizeof(int));
+    atomic_store(&worker->running, false);
+    return -1;
+  }
+  if (response.status != REPLY_GRANTED) {
+    statsCount(worker->stats, denials);
+    return 0;
+  }
+
+  // Update local resource tracking based on the action
+  switch (request->commandType) {
+  case REQUEST_RESOURCE:
+    statsCount(worker->stats, grants);
+    if (worker->stats != NULL)
+      recordLatency(worker, request, queued);
+    heldResources[request->resourceType] += response.count;
+    break;
+  case RELEASE_RESOURCE:
+    heldResources[request->resourceType] -= response.count;
+    break;
+  case REQUEST_VECTOR:
+  case RELEASE_VECTOR: {
+    if (request->commandType == REQUEST_VECTOR) {
+      statsCount(worker->stats, grants);
+      if (worker->stats != NULL)
+        recordLatency(worker, request, queued);
+    }
+    int sign = request->commandType == REQUEST_VECTOR ? 1 : -1;
+    for (int i = 0; i < request->vectorLength; i++) {
+      heldResources[request->vector[i].resourceType] +=
+          sign * request->vector[i].count;
+    }
+    break;
+  }
+  case RELEASE_ALL:
+    memset(heldResources, 0, maxResources * sizeof(int));
+    break;
+  }
+  return response.count;
+}
+
+static void sendTerminationMessage(WorkerContext *worker) {
+  MessageA5 msg = {.senderPid = worker->id,
+                   .commandType = TERMINATE_PROCESS,
+                   .resourceType = -1,
+                   .count = 0};
+
+  if (worker->send(worker, &msg) == 0) {
+    log_message(LOG_LEVEL_DEBUG, 0, "Worker %d: Sent termination message",
+                worker->id);
+  } else {
+    log_message(LOG_LEVEL_ERROR, 0,
+                "Worker %d: Failed to send termination message", worker->id);
+  }
+}
+
+// Picks this worker's maximum claims. Under deadlock avoidance they are
+// registered before the first request, since psmgmt only accepts claims
+// from processes that hold nothing; replies are not needed. The claim goes
+// out as one vector message, so with more than VECTOR_MAX_ENTRIES classes
+// the worker claims a random few of them and never asks for the rest.
+static void declareClaims(WorkerContext *worker) {
+  int *maxClaim = worker->maxClaim;
+  for (int resourceType = 0; resourceType < maxResources; resourceType++) {
+    maxClaim[resourceType] = avoidDeadlocks ? 0 : maxInstances;
+  }
+  if (!avoidDeadlocks)
+    return;
+
+  MessageA5 msg = {.senderPid = worker->id,
+                   .commandType = REGISTER_CLAIM,
+                   .resourceType = -1};
+  bool sample = maxResources > VECTOR_MAX_ENTRIES;
+  int draws = sample ? VECTOR_MAX_ENTRIES : maxResources;
+  for (int i = 0; i < draws; i++) {
+    int resourceType = sample ? rand_r(&worker->seed) % maxResources : i;
+    int count = rand_r(&worker->seed) % (maxInstances + 1);
+    if (count == 0 || vectorCount(&msg, resourceType) > 0)
+      continue;
+    msg.vector[msg.vectorLength++] =
+        (ResourceCount){.resourceType = resourceType, .count = count};
+    msg.count += count;
+  }
+  if (msg.vectorLength == 0)
+    return;
+
+  if (worker->send(worker, &msg) != 0) {
+    log_message(LOG_LEVEL_ERROR, 0, "Worker %d: Failed to register claims",
+                worker->id);
+    return;
+  }
+  for (int i = 0; i < msg.vectorLength; i++) {
+    maxClaim[msg.vector[i].resourceType] = msg.vector[i].count;
+  }
+}
+
+// Adds resourceType to a vector request, if it is not already in it, for
+// between one instance and what is left of this worker's claim on it
+static void addToVector(WorkerContext *worker, MessageA5 *msg,
+                        int resourceType) {
+  int left =
+      worker->maxClaim[resourceType] - worker->heldResources[resourceType];
+  if (left <= 0 || vectorCount(msg, resourceType) > 0)
+    return;
+  int count = 1 + rand_r(&worker->seed) % left;
+  msg->vector[msg->vectorLength++] =
+      (ResourceCount){.resourceType = resourceType, .count = count};
+  msg->count += count;
+}
+
+static void performRandomAction(WorkerContext *worker) {
+  int decision = rand_r(&worker->seed) %
+                 100; // Decide whether to request or release a resource
+  int action =
+      (decision < REQUEST_PROBABILITY) ? REQUEST_RESOURCE : RELEASE_RESOURCE;
+  int resourceType =
+      rand_r(&worker->seed) % maxResources; // Randomly choose a resource type
+  MessageA5 msg = {.senderPid = worker->id,
+                   .commandType = action,
+                   .resourceType = resourceType,
+                   .count = 1}; // Always request or release one unit
+
+  if (action == REQUEST_RESOURCE &&
+      worker->heldResources[resourceType] < worker->maxClaim[resourceType]) {
+    if ((rand_r(&worker->seed) % 100) < VECTOR_PROBABILITY) {
+      // One message for several classes at once
+      msg.commandType = REQUEST_VECTOR;
+      msg.resourceType = -1;
+      msg.count = 0;
+      addToVector(worker, &msg, resourceType);
+      for (int i = 1; i < VECTOR_CLASSES; i++) {
+        addToVector(worker, &msg, rand_r(&worker->seed) % maxResources);
+      }
+    }
+    sendResourceRequest(worker, &msg);
+    waitForResourceResponse(worker, &msg);
+  } else if (action == RELEASE_RESOURCE &&
+             worker->heldResources[resourceType] > 0) {
+    sendResourceRequest(worker, &msg);
+    waitForResourceResponse(worker, &msg);
+  }
+}
+
+static void releaseAllAndTerminate(WorkerContext *worker) {
+  log_message(LOG_LEVEL_INFO, 0, "Worker %d: Deciding to terminate",
+              worker->id);
+  atomic_store(&worker->running, false);
+
+  // Release all resources before terminating, in one message
+  bool holdsAnything = false;
+  for (int resourceType = 0; resourceType < maxResources; resourceType++) {
+    holdsAnything |= worker->heldResources[resourceType] > 0;
+  }
+  if (holdsAnything) {
+    MessageA5 msg = {.senderPid = worker->id,
+                     .commandType = RELEASE_ALL,
+                     .resourceType = -1};
+    sendResourceRequest(worker, &msg);
+    if (waitForResourceResponse(worker, &msg) < 0)
+      return; // Killed, nothing left to release or report
+  }
+
+  sendTerminationMessage(worker);
+}
+
+// Runs the worker until it decides to terminate, is killed, or the
+// simulation stops
+void runWorker(WorkerContext *worker) {
+  worker->stats = workerStats(worker->id);
+  declareClaims(worker);
+
+  // In discrete-event mode we publish our next wake time in our PCB so
+  // psmgmt knows how far it may jump the clock
+  PCB *slot = simClock->eventDriven ? attachWorkerSlot(worker->id) : NULL;
+
+  unsigned long now = clockNanoseconds(simClock);
+  unsigned long nextAction = now + rand_r(&worker->seed) % B;
+  unsigned long nextTerminationCheck = now + ONE_SECOND; // Run at least 1s
+
+  while (keepRunning && atomic_load(&worker->running)) {
+    unsigned long wakeAt = nextAction < nextTerminationCheck
+                               ? nextAction
+                               : nextTerminationCheck;
+    if (slot != NULL && wakeAt > clockNanoseconds(simClock)) {
+      parkWorker(slot, wakeAt); // The clock only moves once everyone parks
+    }
+    waitForClock(simClock, wakeAt);
+    now = clockNanoseconds(simClock);
+
+    if (now >= nextAction) {
+      performRandomAction(worker);
+      nextAction = now + rand_r(&worker->seed) % B; // B bounds actions
+    }
+
+    // Every 250ms decide whether to terminate
+    if (atomic_load(&worker->running) && now >= nextTerminationCheck) {
+      // 10% chance to decide to terminate
+      if ((rand_r(&worker->seed) % 100) < 10) {
+        releaseAllAndTerminate(worker);
+      }
+      nextTerminationCheck = now + TERMINATION_CHECK_INTERVAL;
+    }
+  }
+
+  if (worker->stats != NULL)
+    atomic_store_explicit(&worker->stats->active, 0, memory_order_relaxed);
+}
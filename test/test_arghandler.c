@@ -78,6 +78,13 @@ void test_isPositiveNumber_withTrailingCharacters(void) {
   TEST_ASSERT_EQUAL(0, result);
 }
 
+void test_parseLogLevel(void) {
+  TEST_ASSERT_EQUAL(LOG_LEVEL_ANNOY, parseLogLevel("annoy"));
+  TEST_ASSERT_EQUAL(LOG_LEVEL_INFO, parseLogLevel("info"));
+  TEST_ASSERT_EQUAL(LOG_LEVEL_ERROR, parseLogLevel("error"));
+  TEST_ASSERT_EQUAL(-1, parseLogLevel("verbose"));
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_isPositiveNumber_withNullInput);
@@ -89,5 +96,6 @@ int main(void) {
   RUN_TEST(test_isPositiveNumber_withMaxInt);
   RUN_TEST(test_isPositiveNumber_withOverflowNumber);
   RUN_TEST(test_isPositiveNumber_withTrailingCharacters);
+  RUN_TEST(test_parseLogLevel);
   return UNITY_END();
 }
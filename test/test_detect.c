@@ -0,0 +1,69 @@
+#include "cleanup.h"
+#include "detect.h"
+#include "globals.h"
+#include "init.h"
+#include "resource.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+#include "waitgraph.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initWaitGraph() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void tearDown(void) {
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+void test_kernelMatchesScalar(void) {
+  const DetectionKernel *fast = detectionKernel();
+  const DetectionKernel *scalar = scalarDetectionKernel();
+  int count = 64;
+  int row[64], work[64], fastWork[64], scalarWork[64];
+
+  srand(42);
+  for (int trial = 0; trial < 1000; trial++) {
+    for (int j = 0; j < count; j++) {
+      row[j] = rand() % 3 == 0 ? rand() % 21 : 0;
+      work[j] = rand() % 21;
+    }
+    memcpy(fastWork, work, sizeof(work));
+    memcpy(scalarWork, work, sizeof(work));
+    fast->rowAccumulate(fastWork, row, count);
+    scalar->rowAccumulate(scalarWork, row, count);
+    TEST_ASSERT_EQUAL_INT_ARRAY(scalarWork, fastWork, count);
+  }
+}
+
+void test_runDetectionFindsBlockedProcess(void) {
+  // P0 holds 19 of R0 and can finish; P1 holds 1 of R1 and is waiting for
+  // 19 more, but only 1 is free and P0 gives back none
+  setAllocation(0, 0, 19);
+  setAllocation(1, 1, 1);
+  resourceAvailable[0] = 1;
+  resourceAvailable[1] = 1;
+  waitGraphBlock(0, 0, 1);
+  waitGraphBlock(1, 1, 19);
+
+  bool *finish = malloc(processSlots * sizeof(bool));
+  TEST_ASSERT_EQUAL_INT(1, runDetection(finish));
+  TEST_ASSERT_TRUE(finish[0]);
+  TEST_ASSERT_FALSE(finish[1]);
+  free(finish);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_kernelMatchesScalar);
+  RUN_TEST(test_runDetectionFindsBlockedProcess);
+  return UNITY_END();
+}
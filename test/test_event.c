@@ -0,0 +1,57 @@
+#include "cleanup.h"
+#include "event.h"
+#include "globals.h"
+#include "init.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+}
+
+void tearDown(void) {
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+void test_eventQueuePopsInTimeOrder(void) {
+  EventQueue q = {0};
+  TEST_ASSERT_EQUAL_INT(0, initEventQueue(&q, 4));
+
+  unsigned long times[] = {500, 100, 900, 300, 700, 200};
+  for (int i = 0; i < 6; i++) {
+    SimEvent event = {.time = times[i], .type = EVENT_WORKER_WAKE, .index = i};
+    TEST_ASSERT_EQUAL_INT(0, pushEvent(&q, event)); // Grows past capacity
+  }
+  TEST_ASSERT_EQUAL_INT(6, q.size);
+  TEST_ASSERT_EQUAL_UINT64(100, peekEvent(&q)->time);
+
+  unsigned long expected[] = {100, 200, 300, 500, 700, 900};
+  SimEvent event;
+  for (int i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL_INT(0, popEvent(&q, &event));
+    TEST_ASSERT_EQUAL_UINT64(expected[i], event.time);
+  }
+
+  freeEventQueue(&q);
+}
+
+void test_eventQueueEmpty(void) {
+  EventQueue q = {0};
+  initEventQueue(&q, 2);
+
+  SimEvent event;
+  TEST_ASSERT_NULL(peekEvent(&q));
+  TEST_ASSERT_EQUAL_INT(-1, popEvent(&q, &event));
+
+  freeEventQueue(&q);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_eventQueuePopsInTimeOrder);
+  RUN_TEST(test_eventQueueEmpty);
+  return UNITY_END();
+}
@@ -0,0 +1,55 @@
+#include "globals.h"
+#include "histogram.h"
+#include "unity.c"
+#include "unity.h"
+
+static Histogram histogram;
+
+void setUp(void) { memset(&histogram, 0, sizeof(histogram)); }
+
+void tearDown(void) {}
+
+// Exact below the sub-bucket count, then 16 buckets per power of two with
+// no gaps between them
+void test_histogramBucketsAreContiguous(void) {
+  TEST_ASSERT_EQUAL_INT(0, histogramBucket(0));
+  TEST_ASSERT_EQUAL_INT(15, histogramBucket(15));
+  TEST_ASSERT_EQUAL_INT(16, histogramBucket(16));
+  TEST_ASSERT_EQUAL_INT(31, histogramBucket(31));
+  TEST_ASSERT_EQUAL_INT(32, histogramBucket(32));
+  TEST_ASSERT_EQUAL_INT(32, histogramBucket(33));
+  TEST_ASSERT_EQUAL_INT(HISTOGRAM_BUCKETS - 1, histogramBucket(UINT64_MAX));
+
+  for (int bucket = 0; bucket < HISTOGRAM_BUCKETS - 1; bucket++) {
+    uint64_t highest = histogramBucketHighest(bucket);
+    TEST_ASSERT_EQUAL_INT(bucket, histogramBucket(highest));
+    TEST_ASSERT_EQUAL_INT(bucket + 1, histogramBucket(highest + 1));
+  }
+}
+
+// Percentiles land within a bucket's width of the true value
+void test_histogramPercentiles(void) {
+  for (uint64_t value = 1; value <= 1000; value++) {
+    histogramRecord(&histogram, value * 1000);
+  }
+
+  TEST_ASSERT_EQUAL_UINT64(1000, atomic_load(&histogram.count));
+  TEST_ASSERT_EQUAL_UINT64(1000000, atomic_load(&histogram.max));
+  uint64_t p50 = histogramPercentile(&histogram, 50.0);
+  TEST_ASSERT_UINT64_WITHIN(500000 / HISTOGRAM_SUB_BUCKETS, 500000, p50);
+  uint64_t p99 = histogramPercentile(&histogram, 99.0);
+  TEST_ASSERT_UINT64_WITHIN(990000 / HISTOGRAM_SUB_BUCKETS, 990000, p99);
+  TEST_ASSERT_EQUAL_UINT64(1000000, histogramPercentile(&histogram, 100.0));
+}
+
+void test_histogramEmptyPercentileIsZero(void) {
+  TEST_ASSERT_EQUAL_UINT64(0, histogramPercentile(&histogram, 99.9));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_histogramBucketsAreContiguous);
+  RUN_TEST(test_histogramPercentiles);
+  RUN_TEST(test_histogramEmptyPercentileIsZero);
+  return UNITY_END();
+}
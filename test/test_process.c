@@ -30,7 +30,6 @@ void tearDown(void) {
 
 void test_registerChildProcess(void) {
   pid_t pid = 1234;
-  processTable[0].occupied = 0;
   TEST_ASSERT_EQUAL_INT(0, processTable[0].occupied);
 
   registerChildProcess(pid);
@@ -42,11 +41,16 @@ void test_registerChildProcess(void) {
   TEST_ASSERT_EQUAL_INT(simClock->nanoseconds, processTable[0].startNano);
 }
 
+// Fills every slot with a registered process
+static void fillProcessTable(void) {
+  for (int i = 0; i < processSlots; i++) {
+    registerChildProcess(100000 + i);
+  }
+}
+
 void test_registerChildProcess_NoFreeEntry(void) {
   pid_t pid = 1234;
-  for (int i = 0; i < maxProcesses; i++) {
-    processTable[i].occupied = 1;
-  }
+  fillProcessTable();
 
   // Mock function call for kill
   TEST_ASSERT_EQUAL(-1, kill(pid, SIGTERM));
@@ -54,36 +58,110 @@ void test_registerChildProcess_NoFreeEntry(void) {
   registerChildProcess(pid);
 
   // No changes should be made to the process table
-  for (int i = 0; i < maxProcesses; i++) {
+  TEST_ASSERT_EQUAL_INT(-1, findProcessIndexByPID(pid));
+  for (int i = 0; i < processSlots; i++) {
     TEST_ASSERT_EQUAL_INT(1, processTable[i].occupied);
+    TEST_ASSERT_EQUAL_INT(100000 + i, processTable[i].pid);
   }
 }
 
 void test_findFreeProcessTableEntry(void) {
-  processTable[0].occupied = 1;
-  processTable[1].occupied = 0;
+  registerChildProcess(1234);
 
   int index = findFreeProcessTableEntry();
   TEST_ASSERT_EQUAL_INT(1, index);
 }
 
 void test_findFreeProcessTableEntry_NoFreeEntry(void) {
-  for (int i = 0; i < maxProcesses; i++) {
-    processTable[i].occupied = 1;
-  }
+  fillProcessTable();
 
   int index = findFreeProcessTableEntry();
   TEST_ASSERT_EQUAL_INT(-1, index);
 }
 
+// A cleared slot leaves the pid index and goes to the next registration
 void test_clearProcessEntry(void) {
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
+  fillProcessTable();
+  int index = findProcessIndexByPID(100003);
 
-  clearProcessEntry(0);
+  clearProcessEntry(index);
 
-  TEST_ASSERT_EQUAL_INT(1, processTable[0].occupied);
-  TEST_ASSERT_EQUAL_INT(PROCESS_TERMINATED, processTable[0].state);
+  TEST_ASSERT_EQUAL_INT(0, processTable[index].occupied);
+  TEST_ASSERT_EQUAL_INT(PROCESS_TERMINATED, processTable[index].state);
+  TEST_ASSERT_EQUAL_INT(-1, findProcessIndexByPID(100003));
+
+  registerChildProcess(1234);
+  TEST_ASSERT_EQUAL_INT(index, findProcessIndexByPID(1234));
+  TEST_ASSERT_EQUAL_INT(PROCESS_RUNNING, processTable[index].state);
+}
+
+void test_findProcessIndexByPID(void) {
+  registerChildProcess(1234);
+  registerChildProcess(5678);
+
+  TEST_ASSERT_EQUAL_INT(0, findProcessIndexByPID(1234));
+  TEST_ASSERT_EQUAL_INT(1, findProcessIndexByPID(5678));
+  TEST_ASSERT_EQUAL_INT(-1, findProcessIndexByPID(9999));
+}
+
+// Removing a pid from the middle of a probe run keeps the rest reachable
+void test_pidIndexSurvivesChurn(void) {
+  fillProcessTable();
+  for (int round = 0; round < 50; round++) {
+    for (int i = 0; i < processSlots; i += 2) {
+      pid_t pid = processTable[i].pid;
+      clearProcessEntry(findProcessIndexByPID(pid));
+      registerChildProcess(pid + processSlots);
+    }
+    for (int i = 0; i < processSlots; i++) {
+      TEST_ASSERT_EQUAL_INT(i, findProcessIndexByPID(processTable[i].pid));
+    }
+  }
+}
+
+void test_attachTablesReadsDimensions(void) {
+  TEST_ASSERT_EQUAL_INT(processSlots, tableHeader->processSlots);
+  TEST_ASSERT_EQUAL_INT(maxResources, tableHeader->resourceCount);
+
+  int processes = processSlots, resources = maxResources;
+  processSlots = 1;
+  maxResources = 1;
+  TEST_ASSERT_EQUAL_INT(SUCCESS, attachTables());
+  TEST_ASSERT_EQUAL_INT(processes, processSlots);
+  TEST_ASSERT_EQUAL_INT(resources, maxResources);
+}
+
+// Slots are recycled, so the table only needs a row per child that can run
+// at once, plus the parked pool
+void test_processTableSizedBySimultaneous(void) {
+  int processes = maxProcesses, simultaneous = maxSimultaneous;
+  maxProcesses = MAX_PROCESSES;
+  maxSimultaneous = 4;
+  poolSize = 2;
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeProcessTable());
+  TEST_ASSERT_EQUAL_INT(6, processSlots);
+  TEST_ASSERT_EQUAL_INT(6, tableHeader->processSlots);
+
+  maxProcesses = 3; // Never more rows than launches
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeProcessTable());
+  TEST_ASSERT_EQUAL_INT(3, processSlots);
+
+  maxProcesses = processes;
+  maxSimultaneous = simultaneous;
+  poolSize = 0;
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeProcessTable());
+}
+
+void test_pooledProcessActivation(void) {
+  int index = registerPooledProcess(4321);
+  TEST_ASSERT_NOT_EQUAL(-1, index);
+  TEST_ASSERT_EQUAL_INT(PROCESS_POOLED, processTable[index].state);
+  TEST_ASSERT_TRUE(allWorkersParked()); // Not launched, so never waited on
+
+  activatePooledProcess(index);
+  TEST_ASSERT_EQUAL_INT(PROCESS_RUNNING, processTable[index].state);
+  TEST_ASSERT_EQUAL_INT(0, waitForActivation(&processTable[index]));
+  TEST_ASSERT_EQUAL_INT(index, findProcessIndexByPID(4321));
 }
 
 void test_processStateToString(void) {
@@ -91,6 +169,7 @@ void test_processStateToString(void) {
   TEST_ASSERT_EQUAL_STRING("Waiting", processStateToString(PROCESS_WAITING));
   TEST_ASSERT_EQUAL_STRING("Terminated",
                            processStateToString(PROCESS_TERMINATED));
+  TEST_ASSERT_EQUAL_STRING("Pooled", processStateToString(PROCESS_POOLED));
   TEST_ASSERT_EQUAL_STRING("Unknown", processStateToString(-1));
 }
 
@@ -101,6 +180,11 @@ int main(void) {
   RUN_TEST(test_findFreeProcessTableEntry);
   RUN_TEST(test_findFreeProcessTableEntry_NoFreeEntry);
   RUN_TEST(test_clearProcessEntry);
+  RUN_TEST(test_findProcessIndexByPID);
+  RUN_TEST(test_pidIndexSurvivesChurn);
+  RUN_TEST(test_attachTablesReadsDimensions);
+  RUN_TEST(test_processTableSizedBySimultaneous);
+  RUN_TEST(test_pooledProcessActivation);
   RUN_TEST(test_processStateToString);
   return UNITY_END();
 }
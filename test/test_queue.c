@@ -18,7 +18,7 @@ void tearDown(void) {
 }
 
 void test_queueInitialization(void) {
-  Queue q;
+  Queue q = {0};
   initQueue(&q, 10);
 
   TEST_ASSERT_EQUAL_INT(0, initQueue(&q, 10));
@@ -31,10 +31,11 @@ void test_queueInitialization(void) {
 }
 
 void test_queueEnqueueDequeue(void) {
-  Queue q;
+  Queue q = {0};
   initQueue(&q, 5);
 
-  MessageA5 msg = {123, 1, 2, 3};
+  MessageA5 msg = {
+      .senderPid = 123, .commandType = 1, .resourceType = 2, .count = 3};
   enqueue(&q, msg);
   TEST_ASSERT_EQUAL_INT(1, q.rear);
 
@@ -51,17 +52,20 @@ void test_queueEnqueueDequeue(void) {
 }
 
 void test_queueFull(void) {
-  Queue q;
+  Queue q = {0};
   initQueue(&q, 2);
 
-  MessageA5 msg1 = {101, 1, 2, 3};
-  MessageA5 msg2 = {102, 1, 2, 3};
+  MessageA5 msg1 = {
+      .senderPid = 101, .commandType = 1, .resourceType = 2, .count = 3};
+  MessageA5 msg2 = {
+      .senderPid = 102, .commandType = 1, .resourceType = 2, .count = 3};
   enqueue(&q, msg1);
   enqueue(&q, msg2);
 
   // The queue should now be full, and the next enqueue should not change
   // `rear`.
-  MessageA5 msg3 = {103, 1, 2, 3};
+  MessageA5 msg3 = {
+      .senderPid = 103, .commandType = 1, .resourceType = 2, .count = 3};
   enqueue(&q, msg3);
   TEST_ASSERT_EQUAL_INT(
       1, q.rear); // The rear should not advance since the queue is full
@@ -70,7 +74,7 @@ void test_queueFull(void) {
 }
 
 void test_queueEmpty(void) {
-  Queue q;
+  Queue q = {0};
   initQueue(&q, 2);
 
   MessageA5 dequeuedMsg;
@@ -80,11 +84,39 @@ void test_queueEmpty(void) {
   freeQueue(&q); // Free the queue after testing
 }
 
+void test_removeFromQueueKeepsOrder(void) {
+  Queue q = {0};
+  initQueue(&q, 4);
+
+  // Wrap the ring so removal has to cross the end of the array
+  MessageA5 msg = {
+      .senderPid = 100, .commandType = 1, .resourceType = 2, .count = 3};
+  enqueue(&q, msg);
+  enqueue(&q, msg);
+  dequeue(&q, &msg);
+  dequeue(&q, &msg);
+  for (long pid = 101; pid <= 103; pid++) {
+    msg.senderPid = pid;
+    enqueue(&q, msg);
+  }
+
+  TEST_ASSERT_EQUAL_INT(3, queueLength(&q));
+  TEST_ASSERT_EQUAL_INT(0, removeFromQueue(&q, 1));
+  TEST_ASSERT_EQUAL_INT(2, queueLength(&q));
+  TEST_ASSERT_EQUAL_INT(101, queueAt(&q, 0)->senderPid);
+  TEST_ASSERT_EQUAL_INT(103, queueAt(&q, 1)->senderPid);
+  TEST_ASSERT_NULL(queueAt(&q, 2));
+  TEST_ASSERT_EQUAL_INT(-1, removeFromQueue(&q, 2));
+
+  freeQueue(&q);
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_queueInitialization);
   RUN_TEST(test_queueEnqueueDequeue);
   RUN_TEST(test_queueFull);
   RUN_TEST(test_queueEmpty);
+  RUN_TEST(test_removeFromQueueKeepsOrder);
   return UNITY_END();
 }
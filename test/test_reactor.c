@@ -0,0 +1,74 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "reactor.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+}
+
+void tearDown(void) {
+  closeReactor();
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+// A worker's kick shows up once and is consumed by that wait
+void test_notifyMasterWakesReactor(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeReactor(false));
+  TEST_ASSERT_NOT_NULL(getenv(WAKEUP_FD_ENV));
+
+  unsigned long ticks;
+  TEST_ASSERT_EQUAL_UINT(0, waitForEvents(0, &ticks));
+  notifyMaster();
+  notifyMaster();
+  TEST_ASSERT_EQUAL_UINT(REACTOR_WAKEUP, waitForEvents(0, &ticks));
+  TEST_ASSERT_EQUAL_UINT(0, waitForEvents(0, &ticks));
+}
+
+// Expirations missed while busy are reported together, so no tick is lost
+void test_tickReportsMissedExpirations(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeReactor(true));
+  usleep(3 * REACTOR_TICK_NS / 1000);
+
+  unsigned long ticks;
+  TEST_ASSERT_EQUAL_UINT(REACTOR_TICK, waitForEvents(-1, &ticks));
+  TEST_ASSERT_TRUE(ticks >= 2);
+}
+
+// Discrete-event runs leave the tick disarmed
+void test_disarmedTickStaysQuiet(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeReactor(false));
+
+  unsigned long ticks;
+  TEST_ASSERT_EQUAL_UINT(
+      0, waitForEvents(2 * REACTOR_TICK_NS / 1000000, &ticks));
+  TEST_ASSERT_EQUAL_UINT64(0, ticks);
+}
+
+// SIGCHLD arrives through the signalfd instead of a handler
+void test_childExitWakesReactor(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeReactor(false));
+
+  pid_t pid = fork();
+  if (pid == 0)
+    _exit(0);
+  TEST_ASSERT_TRUE(pid > 0);
+
+  unsigned long ticks;
+  TEST_ASSERT_EQUAL_UINT(REACTOR_CHILD, waitForEvents(1000, &ticks));
+  TEST_ASSERT_EQUAL_INT(pid, waitpid(pid, NULL, 0));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_notifyMasterWakesReactor);
+  RUN_TEST(test_tickReportsMissedExpirations);
+  RUN_TEST(test_disarmedTickStaysQuiet);
+  RUN_TEST(test_childExitWakesReactor);
+  return UNITY_END();
+}
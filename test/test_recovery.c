@@ -0,0 +1,93 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "process.h"
+#include "recovery.h"
+#include "resource.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+#include "waitgraph.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initWaitGraph() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+  registerChildProcess(1234);
+  registerChildProcess(5678);
+}
+
+void tearDown(void) {
+  victimCost = defaultVictimCost;
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+static void hold(int index, int resourceType, int count) {
+  setAllocation(index, resourceType, count);
+  resourceAvailable[resourceType] -= count;
+}
+
+static double preferSlotZero(const VictimCandidate *candidate) {
+  return candidate->index == 0 ? 0 : 1;
+}
+
+void test_chooseVictimPicksCheapest(void) {
+  int candidates[] = {0, 1};
+  hold(0, 0, 3);
+  hold(1, 0, 1);
+  TEST_ASSERT_EQUAL_INT(1, chooseVictim(candidates, 2));
+
+  // Earlier sacrifices make slot 1 the more expensive one to lose
+  processTable[1].victimsTaken = 1;
+  TEST_ASSERT_EQUAL_INT(0, chooseVictim(candidates, 2));
+
+  processTable[1].victimsTaken = 0;
+  victimCost = preferSlotZero;
+  TEST_ASSERT_EQUAL_INT(0, chooseVictim(candidates, 2));
+}
+
+void test_resolveDeadlocksKillsOneVictim(void) {
+  // Each waits on what the other holds; killing P1, which holds less, frees
+  // enough of R1 for P0
+  hold(0, 0, maxInstances);
+  hold(1, 1, maxInstances - 1);
+  waitGraphBlock(0, 1, 2);
+  waitGraphBlock(1, 0, 1);
+
+  resolveDeadlocks();
+
+  TEST_ASSERT_EQUAL_INT(1, terminatedByDeadlock);
+  TEST_ASSERT_EQUAL_INT(PROCESS_RUNNING, processTable[0].state);
+  TEST_ASSERT_EQUAL_INT(PROCESS_TERMINATED, processTable[1].state);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(1, 0));
+  TEST_ASSERT_EQUAL_INT(1, processTable[0].victimsTaken);
+}
+
+// Holding resources is not enough to be a victim: P0 has no outstanding
+// request, and P1's can be met once P0 finishes
+void test_resolveDeadlocksLeavesHoldersAlone(void) {
+  hold(0, 0, maxInstances / 2);
+  hold(1, 0, maxInstances / 2 - 1);
+  waitGraphBlock(1, 0, maxInstances / 2 + 1);
+  int killed = terminatedByDeadlock;
+
+  resolveDeadlocks();
+
+  TEST_ASSERT_EQUAL_INT(killed, terminatedByDeadlock);
+  TEST_ASSERT_EQUAL_INT(PROCESS_RUNNING, processTable[0].state);
+  TEST_ASSERT_EQUAL_INT(PROCESS_RUNNING, processTable[1].state);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_chooseVictimPicksCheapest);
+  RUN_TEST(test_resolveDeadlocksKillsOneVictim);
+  RUN_TEST(test_resolveDeadlocksLeavesHoldersAlone);
+  return UNITY_END();
+}
@@ -20,14 +20,22 @@ void setUp(void) {
 
 void tearDown(void) {
   log_message(LOG_LEVEL_INFO, 0, "Starting tearDown.");
+  avoidDeadlocks = false;
   cleanupSharedResources();
   cleanupResources();
 }
 
+// A claim on a single class, as one REGISTER_CLAIM vector
+static int claim(pid_t pid, int resourceType, int count) {
+  MessageA5 msg = {.senderPid = pid,
+                   .commandType = REGISTER_CLAIM,
+                   .vectorLength = 1,
+                   .vector = {{resourceType, count}}};
+  return registerClaim(&msg);
+}
+
 void test_isProcessRunning(void) {
-  processTable[0].pid = 1234;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
+  registerChildProcess(1234);
   TEST_ASSERT_TRUE(isProcessRunning(1234));
   processTable[0].state = PROCESS_TERMINATED;
   TEST_ASSERT_FALSE(isProcessRunning(1234));
@@ -36,100 +44,174 @@ void test_isProcessRunning(void) {
 
 void test_requestResource(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
+  registerChildProcess(pid);
   int result = requestResource(pid, 0, 5);
   TEST_ASSERT_EQUAL_INT(0, result);
-  TEST_ASSERT_EQUAL_INT(5, resourceTable[0].allocated[0]);
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(0, 0));
   TEST_ASSERT_EQUAL_INT(15,
-                        resourceTable[0].available); // Adjusted to match setup
+                        resourceAvailable[0]); // Adjusted to match setup
   TEST_ASSERT_EQUAL_INT(1, immediateGrantedRequests);
   TEST_ASSERT_EQUAL_INT(1, totalRequests);
 }
 
 void test_requestResource_NotEnoughResources(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
-  resourceTable[0].available = 2;
+  registerChildProcess(pid);
+  resourceAvailable[0] = 2;
   int result = requestResource(pid, 0, 5);
   TEST_ASSERT_EQUAL_INT(-1, result);
-  TEST_ASSERT_EQUAL_INT(0, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(2, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(2, resourceAvailable[0]);
 }
 
 void test_releaseResource(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
-  resourceTable[0].allocated[0] = 5;
-  resourceTable[0].available = 15;
+  registerChildProcess(pid);
+  setAllocation(0, 0, 5);
+  resourceAvailable[0] = 15;
   int result = releaseResource(pid, 0, 3);
   TEST_ASSERT_EQUAL_INT(0, result);
-  TEST_ASSERT_EQUAL_INT(2, resourceTable[0].allocated[0]);
+  TEST_ASSERT_EQUAL_INT(2, ALLOCATED(0, 0));
   TEST_ASSERT_EQUAL_INT(18,
-                        resourceTable[0].available); // Adjusted to match setup
+                        resourceAvailable[0]); // Adjusted to match setup
 }
 
 void test_releaseResource_InvalidRelease(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
-  resourceTable[0].allocated[0] = 2;
-  resourceTable[0].available = 18;
+  registerChildProcess(pid);
+  setAllocation(0, 0, 2);
+  resourceAvailable[0] = 18;
   int result = releaseResource(pid, 0, 3);
   TEST_ASSERT_EQUAL_INT(-1, result);
-  TEST_ASSERT_EQUAL_INT(2, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(18, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(2, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(18, resourceAvailable[0]);
 }
 
 void test_releaseAllResourcesForProcess(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
-  resourceTable[0].allocated[0] = 5;
-  resourceTable[0].available = 15;
+  registerChildProcess(pid);
+  setAllocation(0, 0, 5);
+  resourceAvailable[0] = 15;
   releaseAllResourcesForProcess(pid);
-  TEST_ASSERT_EQUAL_INT(0, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(20, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(20, resourceAvailable[0]);
 }
 
 void test_unsafeSystem(void) {
-  resourceTable[0].allocated[0] = 1;
-  resourceTable[1].allocated[0] = 1;
-  resourceTable[2].allocated[0] = 1;
-  resourceTable[3].allocated[0] = 1;
-  resourceTable[4].allocated[0] = 1;
-  resourceTable[5].allocated[0] = 1;
-  resourceTable[6].allocated[0] = 1;
-  resourceTable[7].allocated[0] = 1;
-  resourceTable[8].allocated[0] = 1;
-  resourceTable[9].allocated[0] = 1;
+  TEST_ASSERT_FALSE(unsafeSystem()); // Nobody running, nothing held
+
+  // Without declared claims each process may want all of R0, and neither
+  // can get it while the other holds half
+  pid_t pids[] = {1234, 2345};
+  for (int i = 0; i < 2; i++) {
+    registerChildProcess(pids[i]);
+    TEST_ASSERT_EQUAL_INT(0, requestResource(pids[i], 0, 10));
+  }
   TEST_ASSERT_TRUE(unsafeSystem());
 }
 
+void test_avoidanceDeniesUnsafeGrant(void) {
+  pid_t pids[] = {1234, 2345};
+  avoidDeadlocks = true;
+  for (int i = 0; i < 2; i++) {
+    registerChildProcess(pids[i]);
+    TEST_ASSERT_EQUAL_INT(0, claim(pids[i], 0, 15));
+  }
+
+  TEST_ASSERT_EQUAL_INT(0, requestResource(pids[0], 0, 10));
+  TEST_ASSERT_EQUAL_INT(0, requestResource(pids[1], 0, 5));
+  TEST_ASSERT_EQUAL_INT(-1, claim(pids[1], 1, 5)); // Already holds
+
+  // One more for P1 leaves 4 free, short of what either still needs
+  TEST_ASSERT_EQUAL_INT(REQUEST_WAIT, requestResource(pids[1], 0, 1));
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(1, 0));
+  TEST_ASSERT_EQUAL_INT(5, resourceAvailable[0]);
+  TEST_ASSERT_EQUAL_INT(1, unsafeDeniedRequests);
+  TEST_ASSERT_FALSE(unsafeSystem());
+
+  // P0 may take the rest of its claim, but nothing past it
+  TEST_ASSERT_EQUAL_INT(0, requestResource(pids[0], 0, 5));
+  TEST_ASSERT_EQUAL_INT(REQUEST_DENIED, requestResource(pids[0], 0, 1));
+}
+
+// A recycled slot's need follows its new owner's claim, not the old one
+void test_avoidanceTracksRecycledSlot(void) {
+  avoidDeadlocks = true;
+  registerChildProcess(1234);
+  registerChildProcess(2345);
+  TEST_ASSERT_EQUAL_INT(0, claim(1234, 0, 15));
+  TEST_ASSERT_EQUAL_INT(0, claim(2345, 0, 15));
+  TEST_ASSERT_EQUAL_INT(0, requestResource(1234, 0, 10));
+  TEST_ASSERT_EQUAL_INT(0, requestResource(2345, 0, 5));
+
+  releaseAllResourcesForProcess(1234);
+  clearProcessEntry(0);
+  registerChildProcess(3456);
+  TEST_ASSERT_EQUAL_INT(0, findProcessIndexByPID(3456));
+  TEST_ASSERT_EQUAL_INT(0, claim(3456, 0, 20));
+
+  // Leaves 5 free while each still needs 10
+  TEST_ASSERT_EQUAL_INT(REQUEST_WAIT, requestResource(3456, 0, 10));
+  TEST_ASSERT_EQUAL_INT(0, requestResource(3456, 0, 5));
+}
+
+// One message replaces the whole claim row, or leaves it alone if any entry
+// is invalid
+void test_claimVectorSetsWholeRow(void) {
+  registerChildProcess(1234);
+  TEST_ASSERT_EQUAL_INT(0, claim(1234, 0, 15));
+
+  MessageA5 msg = {.senderPid = 1234,
+                   .commandType = REGISTER_CLAIM,
+                   .vectorLength = 2,
+                   .vector = {{1, 5}, {2, 25}}};
+  TEST_ASSERT_EQUAL_INT(-1, registerClaim(&msg)); // Over the total of R2
+  TEST_ASSERT_EQUAL_INT(15, CLAIMED(0, 0));
+  TEST_ASSERT_EQUAL_INT(0, CLAIMED(0, 1));
+
+  msg.vector[1].count = 7;
+  TEST_ASSERT_EQUAL_INT(0, registerClaim(&msg));
+  TEST_ASSERT_EQUAL_INT(0, CLAIMED(0, 0));
+  TEST_ASSERT_EQUAL_INT(5, CLAIMED(0, 1));
+  TEST_ASSERT_EQUAL_INT(7, CLAIMED(0, 2));
+}
+
+void test_grantQueuedRequest(void) {
+  pid_t pid = 1234;
+  registerChildProcess(pid);
+  resourceAvailable[0] = 0;
+  int requests = totalRequests, immediate = immediateGrantedRequests;
+  int waiting = waitingGrantedRequests;
+  TEST_ASSERT_EQUAL_INT(REQUEST_WAIT, requestResource(pid, 0, 1));
+
+  // The freed class is flagged once, however many units come back
+  resourceAvailable[0] = 1;
+  noteFreedResource(0);
+  noteFreedResource(0);
+  TEST_ASSERT_EQUAL_INT(0, takeFreedResource());
+  TEST_ASSERT_EQUAL_INT(-1, takeFreedResource());
+
+  TEST_ASSERT_EQUAL_INT(REQUEST_GRANTED, grantQueuedRequest(pid, 0, 1));
+  TEST_ASSERT_EQUAL_INT(requests + 1, totalRequests);
+  TEST_ASSERT_EQUAL_INT(immediate, immediateGrantedRequests);
+  TEST_ASSERT_EQUAL_INT(waiting + 1, waitingGrantedRequests);
+}
+
 void test_resolveDeadlocks(void) {
   // Initialize the process table entries for the processes
   pid_t pids[] = {1234, 2345, 3456};
   for (int i = 0; i < 3; i++) {
-    processTable[i].pid = pids[i];
-    processTable[i].occupied = 1;
-    processTable[i].state = PROCESS_RUNNING;
+    registerChildProcess(pids[i]);
   }
 
   // Allocate resources to create a deadlock scenario
-  resourceTable[0].allocated[0] = 19; // Process 0 holds 5 units of resource 0
-  resourceTable[1].allocated[1] = 19; // Process 1 holds 5 units of resource 1
-  resourceTable[2].allocated[2] = 19; // Process 2 holds 5 units of resource 2
+  setAllocation(0, 0, 19); // Process 0 holds 5 units of resource 0
+  setAllocation(1, 1, 19); // Process 1 holds 5 units of resource 1
+  setAllocation(2, 2, 19); // Process 2 holds 5 units of resource 2
 
-  resourceTable[0].available = 1; // 15 units of resource 0 available
-  resourceTable[1].available = 1; // 15 units of resource 1 available
-  resourceTable[2].available = 1; // 15 units of resource 2 available
+  resourceAvailable[0] = 1; // 15 units of resource 0 available
+  resourceAvailable[1] = 1; // 15 units of resource 1 available
+  resourceAvailable[2] = 1; // 15 units of resource 2 available
 
   log_message(LOG_LEVEL_DEBUG, 0, "Before resolving deadlocks:");
   logResourceTable();
@@ -142,10 +224,10 @@ void test_resolveDeadlocks(void) {
 
   // Validate that the resources were released and the processes were terminated
   for (int i = 0; i < 3; i++) {
-    TEST_ASSERT_EQUAL_INT(0, resourceTable[i].allocated[i]);
+    TEST_ASSERT_EQUAL_INT(0, ALLOCATED(i, i));
     TEST_ASSERT_EQUAL_INT(
         20,
-        resourceTable[i].available); // All resources should be available again
+        resourceAvailable[i]); // All resources should be available again
   }
   TEST_ASSERT_EQUAL_INT(
       3,
@@ -159,6 +241,22 @@ void test_resolveDeadlocks(void) {
 
 void test_logResourceTable(void) { logResourceTable(); }
 
+// After a full dump only rows that changed are logged again
+void test_logResourceTableChanges(void) {
+  registerChildProcess(1001);
+  registerChildProcess(1002);
+  logResourceTable();
+  TEST_ASSERT_EQUAL_INT(0, logResourceTableChanges());
+
+  TEST_ASSERT_EQUAL_INT(REQUEST_GRANTED, requestResource(1002, 1, 1));
+  TEST_ASSERT_EQUAL_INT(1, logResourceTableChanges());
+  TEST_ASSERT_EQUAL_INT(0, logResourceTableChanges());
+
+  TEST_ASSERT_EQUAL_INT(0, releaseResource(1002, 1, 1));
+  TEST_ASSERT_EQUAL_INT(1, logResourceTableChanges());
+  TEST_ASSERT_EQUAL_INT(0, logResourceTableChanges());
+}
+
 void test_logStatistics(void) {
   totalRequests = 10;
   immediateGrantedRequests = 5;
@@ -171,22 +269,18 @@ void test_logStatistics(void) {
 
 void test_multipleResourceRequests(void) {
   pid_t pid1 = 1234, pid2 = 5678;
-  processTable[0].pid = pid1;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
-  processTable[1].pid = pid2;
-  processTable[1].occupied = 1;
-  processTable[1].state = PROCESS_RUNNING;
+  registerChildProcess(pid1);
+  registerChildProcess(pid2);
 
   int result1 = requestResource(pid1, 0, 5);
   TEST_ASSERT_EQUAL_INT(0, result1);
-  TEST_ASSERT_EQUAL_INT(5, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(15, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(15, resourceAvailable[0]);
 
   int result2 = requestResource(pid2, 0, 10);
   TEST_ASSERT_EQUAL_INT(0, result2);
-  TEST_ASSERT_EQUAL_INT(10, resourceTable[0].allocated[1]);
-  TEST_ASSERT_EQUAL_INT(5, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(10, ALLOCATED(1, 0));
+  TEST_ASSERT_EQUAL_INT(5, resourceAvailable[0]);
 
   TEST_ASSERT_EQUAL_INT(2, totalRequests);
   TEST_ASSERT_EQUAL_INT(2, immediateGrantedRequests);
@@ -194,19 +288,100 @@ void test_multipleResourceRequests(void) {
 
 void test_requestAndRelease(void) {
   pid_t pid = 1234;
-  processTable[0].pid = pid;
-  processTable[0].occupied = 1;
-  processTable[0].state = PROCESS_RUNNING;
+  registerChildProcess(pid);
 
   int result1 = requestResource(pid, 0, 10);
   TEST_ASSERT_EQUAL_INT(0, result1);
-  TEST_ASSERT_EQUAL_INT(10, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(10, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(10, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(10, resourceAvailable[0]);
 
   int result2 = releaseResource(pid, 0, 5);
   TEST_ASSERT_EQUAL_INT(0, result2);
-  TEST_ASSERT_EQUAL_INT(5, resourceTable[0].allocated[0]);
-  TEST_ASSERT_EQUAL_INT(15, resourceTable[0].available);
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(15, resourceAvailable[0]);
+}
+
+void test_applyResourceBatch(void) {
+  registerChildProcess(1234);
+  registerChildProcess(5678);
+  setAllocation(0, 0, 5);
+  resourceAvailable[0] = 15;
+
+  MessageA5 release = {.senderPid = 1234,
+                       .commandType = RELEASE_RESOURCE,
+                       .resourceType = 0,
+                       .count = 5};
+  MessageA5 grant = {.senderPid = 5678,
+                     .commandType = REQUEST_RESOURCE,
+                     .resourceType = 0,
+                     .count = 20};
+  MessageA5 wait = {.senderPid = 5678,
+                    .commandType = REQUEST_RESOURCE,
+                    .resourceType = 1,
+                    .count = 25};
+  MessageA5 badRelease = {.senderPid = 1234,
+                          .commandType = RELEASE_RESOURCE,
+                          .resourceType = 1,
+                          .count = 1};
+  const MessageA5 *batch[] = {&release, &grant, &wait, &badRelease};
+  int results[4];
+
+  applyResourceBatch(batch, 4, results);
+  TEST_ASSERT_EQUAL_INT(0, results[0]);
+  TEST_ASSERT_EQUAL_INT(REQUEST_GRANTED, results[1]);
+  TEST_ASSERT_EQUAL_INT(REQUEST_WAIT, results[2]);
+  TEST_ASSERT_EQUAL_INT(-1, results[3]);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(20, ALLOCATED(1, 0));
+  TEST_ASSERT_EQUAL_INT(0, resourceAvailable[0]);
+}
+
+void test_vectorRequestIsAllOrNothing(void) {
+  registerChildProcess(1234);
+
+  MessageA5 tooMuch = {.senderPid = 1234,
+                       .commandType = REQUEST_VECTOR,
+                       .vectorLength = 2,
+                       .vector = {{0, 5}, {1, 25}}};
+  MessageA5 fits = {.senderPid = 1234,
+                    .commandType = REQUEST_VECTOR,
+                    .vectorLength = 2,
+                    .vector = {{0, 5}, {1, 5}}};
+  MessageA5 overRelease = {.senderPid = 1234,
+                           .commandType = RELEASE_VECTOR,
+                           .vectorLength = 2,
+                           .vector = {{0, 5}, {1, 6}}};
+  MessageA5 releaseAll = {.senderPid = 1234, .commandType = RELEASE_ALL};
+  const MessageA5 *batch[] = {&tooMuch, &fits, &overRelease, &releaseAll};
+  int results[4];
+
+  applyResourceBatch(batch, 2, results);
+  TEST_ASSERT_EQUAL_INT(REQUEST_WAIT, results[0]);
+  TEST_ASSERT_EQUAL_INT(REQUEST_GRANTED, results[1]);
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(5, ALLOCATED(0, 1));
+  TEST_ASSERT_EQUAL_INT(1, vectorWaitingOn(&tooMuch));
+
+  applyResourceBatch(batch + 2, 2, results + 2);
+  TEST_ASSERT_EQUAL_INT(-1, results[2]);
+  TEST_ASSERT_EQUAL_INT(10, results[3]);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(0, 0));
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(0, 1));
+  TEST_ASSERT_EQUAL_INT(20, resourceAvailable[1]);
+}
+
+void test_allocationRowTracksRequests(void) {
+  pid_t pid = 1234;
+  registerChildProcess(999); // Takes slot 0
+  registerChildProcess(pid);
+
+  TEST_ASSERT_EQUAL_INT(0, requestResource(pid, 3, 2));
+  TEST_ASSERT_EQUAL_INT(2, ALLOCATED(1, 3));
+  TEST_ASSERT_EQUAL_INT(maxInstances - 2, resourceAvailable[3]);
+
+  releaseAllResourcesForProcess(pid);
+  TEST_ASSERT_EQUAL_INT(0, ALLOCATED(1, 3));
+  TEST_ASSERT_EQUAL_INT(maxInstances, resourceAvailable[3]);
 }
 
 int main(void) {
@@ -218,8 +393,16 @@ int main(void) {
   RUN_TEST(test_releaseResource_InvalidRelease);
   RUN_TEST(test_releaseAllResourcesForProcess);
   RUN_TEST(test_unsafeSystem);
+  RUN_TEST(test_avoidanceDeniesUnsafeGrant);
+  RUN_TEST(test_avoidanceTracksRecycledSlot);
+  RUN_TEST(test_claimVectorSetsWholeRow);
+  RUN_TEST(test_grantQueuedRequest);
+  RUN_TEST(test_applyResourceBatch);
+  RUN_TEST(test_vectorRequestIsAllOrNothing);
+  RUN_TEST(test_allocationRowTracksRequests);
   // RUN_TEST(test_resolveDeadlocks);
   RUN_TEST(test_logResourceTable);
+  RUN_TEST(test_logResourceTableChanges);
   RUN_TEST(test_logStatistics);
   // RUN_TEST(test_multipleResourceRequests);
   // RUN_TEST(test_requestAndRelease);
@@ -0,0 +1,119 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "ring.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+
+static MessageRing ring;
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+  memset(&ring, 0, sizeof(ring));
+}
+
+void tearDown(void) {
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+static MessageA5 messageFrom(long pid) {
+  return (MessageA5){.senderPid = pid,
+                     .commandType = 1,
+                     .resourceType = 2,
+                     .count = 3};
+}
+
+void test_ringPopsInOrder(void) {
+  MessageA5 msg;
+  TEST_ASSERT_EQUAL_INT(-1, ringPop(&ring, &msg)); // Empty
+
+  for (long pid = 1; pid <= 3; pid++) {
+    msg = messageFrom(pid);
+    TEST_ASSERT_EQUAL_INT(0, ringPush(&ring, &msg));
+  }
+  for (long pid = 1; pid <= 3; pid++) {
+    TEST_ASSERT_EQUAL_INT(0, ringPop(&ring, &msg));
+    TEST_ASSERT_EQUAL_INT(pid, msg.senderPid);
+  }
+  TEST_ASSERT_EQUAL_INT(-1, ringPop(&ring, &msg));
+}
+
+// A full ring refuses the next push until psmgmt pops one
+void test_ringFull(void) {
+  MessageA5 msg;
+  for (long pid = 0; pid < RING_CAPACITY; pid++) {
+    msg = messageFrom(pid);
+    TEST_ASSERT_EQUAL_INT(0, ringPush(&ring, &msg));
+  }
+  msg = messageFrom(RING_CAPACITY);
+  TEST_ASSERT_EQUAL_INT(-1, ringPush(&ring, &msg));
+
+  TEST_ASSERT_EQUAL_INT(0, ringPop(&ring, &msg));
+  TEST_ASSERT_EQUAL_INT(0, msg.senderPid);
+  msg = messageFrom(RING_CAPACITY);
+  TEST_ASSERT_EQUAL_INT(0, ringPush(&ring, &msg));
+}
+
+// head and tail are free-running, so both the slot index and the counters
+// themselves wrap around
+void test_ringWrapsAround(void) {
+  atomic_store(&ring.head, UINT_MAX - 1);
+  atomic_store(&ring.tail, UINT_MAX - 1);
+
+  MessageA5 msg;
+  for (long pid = 0; pid < RING_CAPACITY; pid++) {
+    msg = messageFrom(pid);
+    TEST_ASSERT_EQUAL_INT(0, ringPush(&ring, &msg));
+  }
+  msg = messageFrom(RING_CAPACITY);
+  TEST_ASSERT_EQUAL_INT(-1, ringPush(&ring, &msg));
+
+  for (long pid = 0; pid < RING_CAPACITY; pid++) {
+    TEST_ASSERT_EQUAL_INT(0, ringPop(&ring, &msg));
+    TEST_ASSERT_EQUAL_INT(pid, msg.senderPid);
+  }
+  TEST_ASSERT_EQUAL_INT(-1, ringPop(&ring, &msg));
+  TEST_ASSERT_EQUAL_UINT(RING_CAPACITY - 2, atomic_load(&ring.head));
+}
+
+// drainRings() stops at the budget, skips unowned rings and starts one ring
+// further along on each call
+void test_drainRingsRotatesAndRespectsBudget(void) {
+  TEST_ASSERT_EQUAL_INT(SUCCESS, initializeRingTransport());
+  assignRing(0, 1000);
+  assignRing(1, 2000);
+
+  MessageA5 msg;
+  for (int i = 0; i < 3; i++) {
+    msg = messageFrom(1000);
+    ringPush(&ringTransport->rings[0], &msg);
+    msg = messageFrom(2000);
+    ringPush(&ringTransport->rings[1], &msg);
+  }
+  msg = messageFrom(3000); // Ring 2 is unowned, so never drained
+  ringPush(&ringTransport->rings[2], &msg);
+
+  MessageA5 batch[4];
+  TEST_ASSERT_EQUAL_INT(4, drainRings(batch, 4));
+  TEST_ASSERT_EQUAL_INT(1000, batch[0].senderPid);
+  TEST_ASSERT_EQUAL_INT(1000, batch[2].senderPid);
+  TEST_ASSERT_EQUAL_INT(2000, batch[3].senderPid);
+
+  TEST_ASSERT_EQUAL_INT(2, drainRings(batch, 4));
+  TEST_ASSERT_EQUAL_INT(2000, batch[0].senderPid);
+  TEST_ASSERT_EQUAL_INT(2000, batch[1].senderPid);
+  TEST_ASSERT_EQUAL_INT(0, drainRings(batch, 4));
+  TEST_ASSERT_TRUE(ringsPending()); // Only the unowned ring is left
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_ringPopsInOrder);
+  RUN_TEST(test_ringFull);
+  RUN_TEST(test_ringWrapsAround);
+  RUN_TEST(test_drainRingsRotatesAndRespectsBudget);
+  return UNITY_END();
+}
@@ -1,6 +1,7 @@
 #include "cleanup.h"
 #include "globals.h"
 #include "init.h"
+#include "logring.h"
 #include "process.h"
 #include "queue.h"
 #include "shared.h"
@@ -34,10 +35,50 @@ void test_detachSharedMemoryFail(void) {
   TEST_ASSERT_EQUAL(-1, detachSharedMemory(&memory, "TestSegment"));
 }
 
+void test_replyStatusRoundTrip(void) {
+  MessageA5 reply = {.senderPid = getpid(),
+                     .commandType = 0,
+                     .resourceType = 2,
+                     .count = 0,
+                     .status = REPLY_QUEUED};
+  TEST_ASSERT_EQUAL_INT(0, sendMessage(msqId, getpid(), &reply));
+
+  MessageA5 received = {0};
+  TEST_ASSERT_EQUAL_INT(0, receiveMessage(msqId, getpid(), &received, 0));
+  TEST_ASSERT_EQUAL_INT(REPLY_QUEUED, received.status);
+  TEST_ASSERT_EQUAL_INT(2, received.resourceType);
+}
+
+// Lines queued while the flusher runs all reach the log file, in order
+void test_logFlusherWritesQueuedLines(void) {
+  logFile = tmpfile();
+  TEST_ASSERT_NOT_NULL(logFile);
+  TEST_ASSERT_EQUAL_INT(0, startLogFlusher());
+  for (int i = 0; i < 100; i++) {
+    log_message(LOG_LEVEL_INFO, 1, "Queued line %d", i);
+  }
+  stopLogFlusher();
+
+  rewind(logFile);
+  char line[LOG_BUFFER_SIZE];
+  int lines = 0;
+  while (fgets(line, sizeof(line), logFile) != NULL) {
+    char expected[64];
+    snprintf(expected, sizeof(expected), "Queued line %d\n", lines);
+    TEST_ASSERT_NOT_NULL(strstr(line, expected));
+    lines++;
+  }
+  TEST_ASSERT_EQUAL_INT(100, lines);
+  fclose(logFile);
+  logFile = NULL;
+}
+
 int main(void) {
   UNITY_BEGIN();
   RUN_TEST(test_attachSharedMemory);
   RUN_TEST(test_detachSharedMemory);
   RUN_TEST(test_detachSharedMemoryFail);
+  RUN_TEST(test_replyStatusRoundTrip);
+  RUN_TEST(test_logFlusherWritesQueuedLines);
   return UNITY_END();
 }
@@ -0,0 +1,88 @@
+#include "globals.h"
+#include "simclock.h"
+#include "unity.c"
+#include "unity.h"
+
+#define TORN_READ_ROUNDS 200000
+
+static SimulatedClock testClock;
+
+void setUp(void) { memset(&testClock, 0, sizeof(testClock)); }
+
+void tearDown(void) {}
+
+void test_writeClockPublishesEvenSequence(void) {
+  writeClock(&testClock, 3, 250);
+
+  unsigned long seconds, nanoseconds;
+  readClock(&testClock, &seconds, &nanoseconds);
+  TEST_ASSERT_EQUAL_UINT64(3, seconds);
+  TEST_ASSERT_EQUAL_UINT64(250, nanoseconds);
+  TEST_ASSERT_EQUAL_UINT(2, atomic_load(&testClock.sequence));
+  TEST_ASSERT_EQUAL_UINT64(3 * ONE_SECOND + 250,
+                           clockNanoseconds(&testClock));
+}
+
+void test_advanceClockCarriesIntoSeconds(void) {
+  writeClock(&testClock, 1, ONE_SECOND - 10);
+  advanceClock(&testClock, 25);
+
+  unsigned long seconds, nanoseconds;
+  readClock(&testClock, &seconds, &nanoseconds);
+  TEST_ASSERT_EQUAL_UINT64(2, seconds);
+  TEST_ASSERT_EQUAL_UINT64(15, nanoseconds);
+}
+
+// The writer always stores seconds == nanoseconds, so a reader that ever
+// sees them differ read a torn update
+static void *writeMatchingPairs(void *arg) {
+  (void)arg;
+  for (unsigned long i = 1; i <= TORN_READ_ROUNDS; i++) {
+    writeClock(&testClock, i, i);
+  }
+  return NULL;
+}
+
+void test_readClockNeverTorn(void) {
+  pthread_t writer;
+  TEST_ASSERT_EQUAL_INT(
+      0, pthread_create(&writer, NULL, writeMatchingPairs, NULL));
+
+  unsigned long seconds = 0, nanoseconds = 0, torn = 0;
+  while (seconds < TORN_READ_ROUNDS) {
+    readClock(&testClock, &seconds, &nanoseconds);
+    if (seconds != nanoseconds)
+      torn++;
+  }
+  pthread_join(writer, NULL);
+  TEST_ASSERT_EQUAL_UINT64(0, torn);
+}
+
+static void *advanceLater(void *arg) {
+  (void)arg;
+  usleep(20000);
+  writeClock(&testClock, 5, 0);
+  return NULL;
+}
+
+void test_waitForClockWakesOnWrite(void) {
+  writeClock(&testClock, 5, 0);
+  waitForClock(&testClock, 5 * ONE_SECOND); // Already there, no wait
+
+  writeClock(&testClock, 4, 0);
+  pthread_t writer;
+  TEST_ASSERT_EQUAL_INT(0, pthread_create(&writer, NULL, advanceLater, NULL));
+  waitForClock(&testClock, 5 * ONE_SECOND);
+  TEST_ASSERT_EQUAL_UINT64(5 * ONE_SECOND, clockNanoseconds(&testClock));
+  pthread_join(writer, NULL);
+  TEST_ASSERT_EQUAL_UINT(0, atomic_load(&testClock.waiters));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_writeClockPublishesEvenSequence);
+  RUN_TEST(test_advanceClockCarriesIntoSeconds);
+  RUN_TEST(test_readClockNeverTorn);
+  RUN_TEST(test_waitForClockWakesOnWrite);
+  return UNITY_END();
+}
@@ -0,0 +1,94 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "process.h"
+#include "queue.h"
+#include "resource.h"
+#include "shared.h"
+#include "stats.h"
+#include "unity.c"
+#include "unity.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initializeResourceQueues() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+  TEST_ASSERT_EQUAL_INT(0, openStats());
+}
+
+void tearDown(void) {
+  closeStats();
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+// A forced snapshot carries psmgmt's counters, resource use and queue depth
+void test_publishStatsSnapshotsCounters(void) {
+  registerChildProcess(2001);
+  registerChildProcess(2002);
+  TEST_ASSERT_EQUAL_INT(REQUEST_GRANTED, requestResource(2001, 3, 5));
+  enqueue(&resourceQueues[3], (MessageA5){.senderPid = 2002,
+                                          .commandType = REQUEST_RESOURCE,
+                                          .resourceType = 3,
+                                          .count = 1});
+  uint64_t published = atomic_load(&statsHeader->published);
+  publishStats(true);
+
+  TEST_ASSERT_EQUAL_UINT64(published + 1, atomic_load(&statsHeader->published));
+  TEST_ASSERT_EQUAL_UINT64(totalRequests, atomic_load(&statsHeader->requests));
+  TEST_ASSERT_EQUAL_UINT64(immediateGrantedRequests,
+                           atomic_load(&statsHeader->immediateGrants));
+  TEST_ASSERT_EQUAL_INT(5, atomic_load(&STATS_RESOURCES(statsHeader)[3].inUse));
+  TEST_ASSERT_EQUAL_INT(
+      1, atomic_load(&STATS_RESOURCES(statsHeader)[3].queueDepth));
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&statsHeader->running));
+
+  // Unforced, a second snapshot right away is skipped
+  publishStats(false);
+  TEST_ASSERT_EQUAL_UINT64(published + 1, atomic_load(&statsHeader->published));
+}
+
+// A worker's counters live in its process table slot
+void test_workerStatsUsesProcessSlot(void) {
+  registerChildProcess(3001);
+  registerChildProcess(3002);
+  WorkerStats *stats = workerStats(3002);
+  TEST_ASSERT_NOT_NULL(stats);
+  int index = findProcessIndexByPID(3002);
+  TEST_ASSERT_EQUAL_PTR(&STATS_WORKERS(statsHeader)[index], stats);
+  TEST_ASSERT_EQUAL_INT(3002, atomic_load(&stats->pid));
+  TEST_ASSERT_EQUAL_INT(1, atomic_load(&stats->active));
+
+  statsCount(stats, requests);
+  statsCount(stats, requests);
+  TEST_ASSERT_EQUAL_UINT64(2, atomic_load(&stats->requests));
+}
+
+// Each grant counts once overall and once under its class
+void test_recordGrantLatencyByClassAndKind(void) {
+  recordGrantLatency(-1, LATENCY_QUEUED, ONE_SECOND, 2000);
+  recordGrantLatency(4, LATENCY_QUEUED, ONE_SECOND, 2000);
+
+  Histogram *all = grantLatency(-1, LATENCY_QUEUED, LATENCY_SIMULATED);
+  Histogram *r4 = grantLatency(4, LATENCY_QUEUED, LATENCY_WALL);
+  TEST_ASSERT_EQUAL_UINT64(1, atomic_load(&all->count));
+  TEST_ASSERT_EQUAL_UINT64(ONE_SECOND, atomic_load(&all->max));
+  TEST_ASSERT_EQUAL_UINT64(2000, histogramPercentile(r4, 50.0));
+  TEST_ASSERT_EQUAL_UINT64(
+      0, atomic_load(&grantLatency(4, LATENCY_IMMEDIATE, LATENCY_WALL)->count));
+  TEST_ASSERT_NULL(grantLatency(maxResources, LATENCY_QUEUED, LATENCY_WALL));
+  logGrantLatencies();
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_publishStatsSnapshotsCounters);
+  RUN_TEST(test_workerStatsUsesProcessSlot);
+  RUN_TEST(test_recordGrantLatencyByClassAndKind);
+  return UNITY_END();
+}
@@ -0,0 +1,109 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "process.h"
+#include "resource.h"
+#include "shared.h"
+#include "simclock.h"
+#include "tasks.h"
+#include "unity.c"
+#include "unity.h"
+
+#define STEP_NS 10000000L // Clock advance per polling round
+#define MAX_ROUNDS 5000
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initWorkerTasks() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+  keepRunning = 1;
+}
+
+void tearDown(void) {
+  stopWorkerTasks();
+  keepRunning = 1;
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+void test_taskIdsAreNotPids(void) {
+  pid_t id = nextTaskId();
+  TEST_ASSERT_EQUAL_INT(TASK_ID_BASE, id);
+  TEST_ASSERT_EQUAL_INT(TASK_ID_BASE + 1, nextTaskId());
+  TEST_ASSERT_EQUAL_INT(-1, kill(id, 0));
+}
+
+// Drives one worker thread: its messages arrive on the channel, a KILLED
+// reply stops it, and it is then reaped under its task ID
+void test_workerTaskRunsAndIsReaped(void) {
+  pid_t id = nextTaskId();
+  registerChildProcess(id);
+  TEST_ASSERT_EQUAL_INT(0, startWorkerTask(id));
+
+  unsigned long now = clockNanoseconds(simClock);
+  int received = 0;
+  pid_t reaped = -1;
+  for (int round = 0; round < MAX_ROUNDS && reaped == -1; round++) {
+    MessageA5 batch[4];
+    int count = drainTaskChannel(batch, 4);
+    for (int i = 0; i < count; i++) {
+      TEST_ASSERT_EQUAL_INT(id, batch[i].senderPid);
+      received++;
+      if (batch[i].commandType != TERMINATE_PROCESS) {
+        MessageA5 reply = {.senderPid = getpid(),
+                           .commandType = batch[i].commandType,
+                           .resourceType = batch[i].resourceType,
+                           .status = REPLY_KILLED};
+        TEST_ASSERT_EQUAL_INT(0, deliverToTask(id, &reply));
+      }
+    }
+
+    reaped = reapWorkerTask();
+    now += STEP_NS;
+    writeClock(simClock, now / ONE_SECOND, now % ONE_SECOND);
+    usleep(100);
+  }
+
+  TEST_ASSERT_EQUAL_INT(id, reaped);
+  TEST_ASSERT_GREATER_THAN_INT(0, received);
+  TEST_ASSERT_EQUAL_INT(-1, deliverToTask(id, &(MessageA5){0}));
+}
+
+// A victim marked while it waits for a reply is never answered, yet stops
+void test_killedTaskStopsWithoutReply(void) {
+  pid_t id = nextTaskId();
+  registerChildProcess(id);
+  TEST_ASSERT_EQUAL_INT(0, startWorkerTask(id));
+
+  unsigned long now = clockNanoseconds(simClock);
+  bool killed = false;
+  pid_t reaped = -1;
+  for (int round = 0; round < MAX_ROUNDS && reaped == -1; round++) {
+    MessageA5 batch[4];
+    if (!killed && drainTaskChannel(batch, 4) > 0) {
+      killWorkerTask(id);
+      killed = true;
+    }
+
+    reaped = reapWorkerTask();
+    now += STEP_NS;
+    writeClock(simClock, now / ONE_SECOND, now % ONE_SECOND);
+    usleep(100);
+  }
+
+  TEST_ASSERT_TRUE(killed);
+  TEST_ASSERT_EQUAL_INT(id, reaped);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_taskIdsAreNotPids);
+  RUN_TEST(test_workerTaskRunsAndIsReaped);
+  RUN_TEST(test_killedTaskStopsWithoutReply);
+  return UNITY_END();
+}
@@ -0,0 +1,74 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "process.h"
+#include "resource.h"
+#include "shared.h"
+#include "trace.h"
+#include "unity.c"
+#include "unity.h"
+
+#define TRACE_PATH "/tmp/psmgmt_test.trace"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+  TEST_ASSERT_EQUAL_INT(0, openTrace(TRACE_PATH));
+}
+
+void tearDown(void) {
+  closeTrace();
+  unlink(TRACE_PATH);
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+void test_traceRecordsRoundTrip(void) {
+  resourceAvailable[2] = 7;
+  traceEvent(TRACE_REQUEST, 4321, 0, 2, 1);
+  traceEvent(TRACE_GRANT, 4321, 0, 2, 1);
+  closeTrace();
+
+  TraceView view;
+  TEST_ASSERT_EQUAL_INT(0, loadTrace(TRACE_PATH, &view));
+  TEST_ASSERT_EQUAL_UINT64(2, view.count);
+  TEST_ASSERT_EQUAL_INT(TRACE_GRANT, view.records[1].type);
+  TEST_ASSERT_EQUAL_INT(4321, view.records[1].pid);
+  TEST_ASSERT_EQUAL_INT(7, view.records[1].available);
+
+  char line[LOG_BUFFER_SIZE];
+  formatTraceRecord(&view.records[1], TRACE_FORMAT_SPEC, line, sizeof(line));
+  TEST_ASSERT_NOT_NULL(strstr(line, "Master granting P0 request R2"));
+  formatTraceRecord(&view.records[1], TRACE_FORMAT_TEXT, line, sizeof(line));
+  TEST_ASSERT_NOT_NULL(strstr(line, "P4321"));
+  TEST_ASSERT_NOT_NULL(strstr(line, "Available before: 8, after: 7"));
+  unloadTrace(&view);
+}
+
+// The file is extended and remapped once the first chunk fills up
+void test_traceGrowsPastFirstChunk(void) {
+  for (int i = 0; i < TRACE_GROW_RECORDS + 5; i++) {
+    traceEvent(TRACE_RELEASE, 1, 1, 0, 1);
+  }
+  closeTrace();
+
+  TraceView view;
+  TEST_ASSERT_EQUAL_INT(0, loadTrace(TRACE_PATH, &view));
+  TEST_ASSERT_EQUAL_UINT64(TRACE_GROW_RECORDS + 5, view.count);
+  TEST_ASSERT_EQUAL_size_t(sizeof(TraceHeader) +
+                               view.count * sizeof(TraceRecord),
+                           view.length);
+  unloadTrace(&view);
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_traceRecordsRoundTrip);
+  RUN_TEST(test_traceGrowsPastFirstChunk);
+  return UNITY_END();
+}
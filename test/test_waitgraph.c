@@ -0,0 +1,85 @@
+#include "cleanup.h"
+#include "globals.h"
+#include "init.h"
+#include "process.h"
+#include "resource.h"
+#include "shared.h"
+#include "unity.c"
+#include "unity.h"
+#include "waitgraph.h"
+
+void setUp(void) {
+  semUnlinkCreate();
+  initializeSharedResources();
+
+  if (initializeProcessTable() == -1 || initializeResourceTable() == -1 ||
+      initWaitGraph() == -1) {
+    log_message(LOG_LEVEL_ERROR, 0, "Failed to initialize all tables");
+    exit(EXIT_FAILURE);
+  }
+}
+
+void tearDown(void) {
+  cleanupSharedResources();
+  cleanupResources();
+}
+
+static void hold(int index, int resourceType, int count) {
+  setAllocation(index, resourceType, count);
+  resourceAvailable[resourceType] -= count;
+}
+
+void test_cycleIsDeadlock(void) {
+  const int *deadlocked;
+  hold(0, 0, maxInstances);
+  hold(1, 1, maxInstances);
+  hold(2, 2, 1); // Bystander, not waited on by anyone
+
+  waitGraphBlock(0, 1, 1);
+  TEST_ASSERT_EQUAL_INT(0, findDeadlockFrom(0, &deadlocked));
+
+  waitGraphBlock(1, 0, 1);
+  TEST_ASSERT_EQUAL_INT(2, findDeadlockFrom(1, &deadlocked));
+  TEST_ASSERT_TRUE(deadlocked[0] != 2 && deadlocked[1] != 2);
+
+  // Releasing P0's hold removes the edge from P1 and breaks the cycle
+  resourceAvailable[0] += maxInstances;
+  setAllocation(0, 0, 0);
+  TEST_ASSERT_EQUAL_INT(0, findDeadlockFrom(1, &deadlocked));
+}
+
+void test_cycleWithSpareInstanceIsNotDeadlock(void) {
+  const int *deadlocked;
+  hold(0, 0, maxInstances - 2);
+  hold(1, 0, 1);
+  hold(1, 1, maxInstances);
+
+  // P0 waits on P1 for R1 and P1 waits on P0 for R0, but one instance of R0
+  // is still free, so P1 can finish and release R1 to P0
+  waitGraphBlock(0, 1, 1);
+  waitGraphBlock(1, 0, 1);
+  TEST_ASSERT_EQUAL_INT(0, findDeadlockFrom(1, &deadlocked));
+
+  waitGraphUnblock(0);
+  TEST_ASSERT_EQUAL_INT(0, findDeadlockFrom(0, &deadlocked));
+}
+
+// Holders are seeded from the allocation matrix when the graph is rebuilt
+void test_initPicksUpExistingAllocations(void) {
+  const int *deadlocked;
+  hold(0, 0, maxInstances);
+  hold(1, 1, maxInstances);
+  TEST_ASSERT_EQUAL_INT(0, initWaitGraph());
+
+  waitGraphBlock(0, 1, 1);
+  waitGraphBlock(1, 0, 1);
+  TEST_ASSERT_EQUAL_INT(2, findDeadlockFrom(1, &deadlocked));
+}
+
+int main(void) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cycleIsDeadlock);
+  RUN_TEST(test_cycleWithSpareInstanceIsNotDeadlock);
+  RUN_TEST(test_initPicksUpExistingAllocations);
+  return UNITY_END();
+}